@@ -63,11 +63,22 @@ static const char* TOPIC_TELE_PAGE = "ha/ledmatrix/tele/page"; // publishes curr
 #define DEFAULT_BRIGHTNESS 80
 #endif
 
+// Brightness changes fade over this long (ms), 0 to jump straight to the new value
+#ifndef BRIGHTNESS_FADE_MS
+#define BRIGHTNESS_FADE_MS 400
+#endif
+
 // Panel config
 #define PANEL_RES_X 64
 #define PANEL_RES_Y 32
 #define PANEL_CHAIN 1
 
+// Some Waveshare panels have G and B swapped in hardware. When set, the G and B data pins are
+// swapped in setupMatrix() so every color in this file can be written as true RGB.
+#ifndef PANEL_SWAP_GB
+#define PANEL_SWAP_GB 1
+#endif
+
 MatrixPanel_I2S_DMA *dma_display = nullptr;   // global display pointer
 
 // Caching sensors
@@ -94,6 +105,89 @@ static inline uint16_t colorFromHSV(uint8_t h, uint8_t s, uint8_t v) {
   return dma_display->color565(c.r, c.g, c.b);
 }
 
+// Brightness fades
+// setBrightness8 sets PWM duty, which the eye sees as anything but linear: a straight ramp in
+// duty races through the dim end and crawls at the top. Fades step through perceived lightness
+// instead, mapped to duty by a CIE 1931 table built once at boot. The MQTT value is still the
+// duty, so end points are exactly what was asked for. The panel is only touched when the duty
+// actually changes, at most once per FADE_STEP_MS, and the fade runs from loop() so it works
+// whatever page is showing.
+
+class BrightnessFader {
+public:
+  static const uint32_t FADE_STEP_MS = 16; // setBrightness8 rewrites the DMA buffers, don't spam it
+
+  void begin(MatrixPanel_I2S_DMA* d, uint8_t duty) {
+    disp = d;
+    for (int l = 0; l < 256; ++l) {
+      // L* 0..100 -> relative luminance
+      const float L = l * 100.0f / 255.0f;
+      const float Y = (L <= 8.0f) ? L / 903.3f : powf((L + 16.0f) / 116.0f, 3.0f);
+      lightnessToDuty[l] = (uint8_t)(Y * 255.0f + 0.5f);
+    }
+    applied = duty;
+    fromL = toL = lightnessOf(duty);
+    target = duty;
+    fading = false;
+    disp->setBrightness8(duty);
+  }
+
+  void setTarget(uint8_t duty, uint32_t now) {
+    if (duty == target) return;
+    target = duty;
+    if (BRIGHTNESS_FADE_MS == 0) {
+      apply(duty, now);
+      fading = false;
+      return;
+    }
+    // Carry on from wherever a fade in progress has got to
+    fromL = lightnessOf(applied);
+    toL = lightnessOf(duty);
+    start = now;
+    fading = true;
+  }
+
+  void update(uint32_t now) {
+    if (!fading || now - lastStep < FADE_STEP_MS) return;
+    const uint32_t t = now - start;
+    if (t >= BRIGHTNESS_FADE_MS) {
+      apply(target, now);
+      fading = false;
+      return;
+    }
+    const int l = fromL + ((int)toL - (int)fromL) * (int)t / (int)BRIGHTNESS_FADE_MS;
+    apply(lightnessToDuty[l], now);
+  }
+
+private:
+  MatrixPanel_I2S_DMA* disp = nullptr;
+  uint8_t lightnessToDuty[256];
+  uint8_t applied = 0, target = 0;
+  uint8_t fromL = 0, toL = 0;
+  uint32_t start = 0, lastStep = 0;
+  bool fading = false;
+
+  // Smallest lightness that reaches duty (the table only ever goes up)
+  uint8_t lightnessOf(uint8_t duty) const {
+    int lo = 0, hi = 255;
+    while (lo < hi) {
+      const int mid = (lo + hi) / 2;
+      if (lightnessToDuty[mid] < duty) lo = mid + 1;
+      else hi = mid;
+    }
+    return (uint8_t)lo;
+  }
+
+  void apply(uint8_t duty, uint32_t now) {
+    lastStep = now;
+    if (duty == applied) return;
+    applied = duty;
+    disp->setBrightness8(duty);
+  }
+};
+
+static BrightnessFader brightness;
+
 // Base class for pages
 
 class DisplayPage {
@@ -421,7 +515,7 @@ void mqttCallback(char* topic, byte* payload, unsigned int length) {
     int b = msg.toInt();
     if (b < 13) b = 13; // clamping brightness to 5% or above
     if (b > 255) b = 255;
-    dma_display->setBrightness8((uint8_t)b);
+    brightness.setTarget((uint8_t)b, millis()); // faded in from loop()
   }
   else if (strcmp(topic, TOPIC_CMD_ROTATESECS) == 0) {
     uint32_t secs = msg.toInt();
@@ -457,13 +551,17 @@ void setupMatrix() {
   #define CLK_PIN 2
   */
 
+#if PANEL_SWAP_GB
   HUB75_I2S_CFG::i2s_pins _pins = {19, 13, 18, 5, 12, 17, 16, 14, 4, 27, 25, 26, 15, 2};
+#else
+  HUB75_I2S_CFG::i2s_pins _pins = {19, 18, 13, 5, 17, 12, 16, 14, 4, 27, 25, 26, 15, 2};
+#endif
   HUB75_I2S_CFG mxconfig(PANEL_RES_X, PANEL_RES_Y, PANEL_CHAIN, _pins);
   mxconfig.i2sspeed = HUB75_I2S_CFG::HZ_10M; // Adjust for panel quality
 
   dma_display = new MatrixPanel_I2S_DMA(mxconfig);
   dma_display->begin();
-  dma_display->setBrightness8(DEFAULT_BRIGHTNESS);
+  brightness.begin(dma_display, DEFAULT_BRIGHTNESS);
   dma_display->clearScreen();
 }
 
@@ -522,6 +620,7 @@ void loop() {
 
   // Update display pages
   uint32_t now = millis();
+  brightness.update(now);
   pageController.update(now);
 }
 
@@ -0,0 +1,596 @@
+#include "bench.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "frame_stats.h"
+#include "render_scheduler.h"
+#include "renderer.h"
+#include "shared_state.h"
+#include "software_canvas.h"
+#include "icons_weather.h"
+#include "text_strip.h"
+#include "text_metrics.h"
+#include "glyph_atlas.h"
+#include "mqtt_dispatch.h"
+#include "render_pool.h"
+#include "frame_hash.h"
+#include "frame_telemetry.h"
+
+using rgb_matrix::Canvas;
+using rgb_matrix::Color;
+
+namespace {
+
+// Panel sizes from a single 64x32 up to a 4x4 wall
+struct PanelSize { int w, h; };
+const PanelSize SIZES[] = { {64, 32}, {128, 32}, {128, 64}, {256, 64}, {256, 128} };
+
+const int64_t FRAME_60HZ_NS = 1000000000LL / 60;
+
+const char *SHORT_TEXT = "Short";
+const char *LONG_TEXT  = "A much longer track title that has to scroll across several panels (Remastered 2011)";
+
+// Forwards every pixel through the virtual SetPixel, like FrameCanvas, so the generic
+// drawing paths are measured rather than the SoftwareCanvas fast paths
+class ForwardingCanvas : public Canvas {
+public:
+    explicit ForwardingCanvas(Canvas *inner) : inner_(inner) {}
+    int width() const override { return inner_->width(); }
+    int height() const override { return inner_->height(); }
+    void SetPixel(int x, int y, uint8_t r, uint8_t g, uint8_t b) override { inner_->SetPixel(x, y, r, g, b); }
+    void Clear() override { inner_->Clear(); }
+    void Fill(uint8_t r, uint8_t g, uint8_t b) override { inner_->Fill(r, g, b); }
+private:
+    Canvas *inner_;
+};
+
+// The per-pixel icon blit BlitIcon replaced, kept as the baseline: a bounds check and a
+// virtual SetPixel for each of the 256 pixels, wherever the icon lands
+void BlitIconPerPixel(const Icon16 *icon, Canvas *canvas, int x, int y) {
+    if (!icon) return;
+    for (int j = 0; j < 16; ++j) {
+        int yy = y + j;
+        if (yy < 0 || yy >= canvas->height()) continue;
+        for (int i = 0; i < 16; ++i) {
+            int xx = x + i;
+            if (xx < 0 || xx >= canvas->width()) continue;
+            int idx = (j * 16 + i) * 3;
+            canvas->SetPixel(xx, yy, icon->pixels[idx], icon->pixels[idx + 1], icon->pixels[idx + 2]);
+        }
+    }
+}
+
+void PrintHeader() {
+    printf("%-28s %9s %9s %9s %9s %9s %9s\n", "stage", "size", "mean", "p50", "p90", "p99", "max");
+}
+
+void PrintRow(const char *stage, const PanelSize &s, const LatencyHistogram &h) {
+    char size[16] = "-";
+    if (s.w > 0) snprintf(size, sizeof(size), "%dx%d", s.w, s.h);
+    printf("%-28s %9s %9.0f %9lld %9lld %9lld %9lld\n", stage, size, h.mean(),
+           (long long)h.Percentile(50), (long long)h.Percentile(90),
+           (long long)h.Percentile(99), (long long)h.max());
+}
+
+// Time fn() `iterations` times, one sample per call. setup() runs untimed before each call.
+// Returns the mean in ns.
+template <typename Setup, typename Fn>
+double Time(const char *stage, const PanelSize &s, int iterations, Setup setup, Fn fn) {
+    LatencyHistogram h;
+    for (int i = 0; i < iterations; ++i) {
+        setup(i);
+        const int64_t t0 = NowNs();
+        fn(i);
+        h.Record(NowNs() - t0);
+    }
+    PrintRow(stage, s, h);
+    return h.mean();
+}
+
+void NoSetup(int) {}
+
+// Full-frame repaints of 4x and 8x chains of 64x32 panels, one tile per panel, on 1 to 4
+// threads. Shows how the tiled renderer scales with cores.
+void RunTiledScaling(const rgb_matrix::Font &font, int iterations) {
+    const PanelSize CHAINS[] = { {256, 32}, {512, 32} };
+    printf("\nTiled full repaint, one 64 px tile per panel\n");
+    PrintHeader();
+    for (const PanelSize &s : CHAINS) {
+        SharedState state;
+        state.SetWeatherCond("rainy", ResolveWeatherIcon("rainy"));
+        state.Set(F_WEATHER_TEMP, "21.5");
+        state.Set(F_WEATHER_SUMMARY, "Partly cloudy, light");
+        state.Set(F_TRACK, LONG_TEXT);
+        state.Set(F_ARTIST, LONG_TEXT);
+        StateData snap;
+        state.Snapshot(snap);
+
+        for (int threads = 1; threads <= 4; ++threads) {
+            SoftwareCanvas canvas(s.w, s.h);
+            RenderPool pool(threads);
+            DisplayRenderer renderer(font, s.w, s.h);
+            renderer.SetTiling(&pool, 64);
+            char stage[32];
+            snprintf(stage, sizeof(stage), "repaint all, %d thread%s", threads, threads > 1 ? "s" : "");
+            Time(stage, s, iterations, NoSetup, [&](int i) {
+                renderer.Tick(i * FRAME_60HZ_NS);
+                renderer.DamageAll();
+                renderer.Update(snap);
+                renderer.Draw(&canvas);
+            });
+        }
+    }
+}
+
+// Static text through the library's DrawText against the run-length glyph atlas, on the
+// given font and the larger ones next to it, into the packed canvas and through SetPixel
+void RunGlyphAtlas(const rgb_matrix::Font &font, const char *font_path, int iterations) {
+    const char *LARGER[] = { "10x20.bdf", "texgyre-27.bdf" };
+    const char *TEXT = "Partly cloudy, 21.5C";
+    const PanelSize s = { 256, 64 };
+
+    std::string dir = font_path;
+    const size_t slash = dir.rfind('/');
+    dir = (slash == std::string::npos) ? "" : dir.substr(0, slash + 1);
+    std::vector<std::unique_ptr<rgb_matrix::Font>> extra;
+    std::vector<std::pair<std::string, const rgb_matrix::Font *>> fonts;
+    auto label = [](std::string name) { return name.substr(0, name.rfind(".bdf")); };
+    fonts.emplace_back(label(slash == std::string::npos ? font_path : font_path + slash + 1), &font);
+    for (const char *name : LARGER) {
+        auto f = std::make_unique<rgb_matrix::Font>();
+        if (!f->LoadFont((dir + name).c_str())) continue;
+        fonts.emplace_back(label(name), f.get());
+        extra.push_back(std::move(f));
+    }
+
+    printf("\nStatic text, DrawText vs glyph atlas\n");
+    PrintHeader();
+    SoftwareCanvas canvas(s.w, s.h);
+    ForwardingCanvas generic(&canvas);
+    const Rect all = MakeRect(0, 0, s.w, s.h);
+    const Color white(255, 255, 255);
+    for (const auto &f : fonts) {
+        const int y = f.second->baseline() + 2;
+        GlyphAtlas atlas(*f.second);
+        char stage[64];
+        snprintf(stage, sizeof(stage), "DrawText %s", f.first.c_str());
+        Time(stage, s, iterations, NoSetup, [&](int) { DrawText(&canvas, *f.second, 0, y, white, nullptr, TEXT); });
+        snprintf(stage, sizeof(stage), "atlas %s", f.first.c_str());
+        Time(stage, s, iterations, NoSetup, [&](int) { atlas.Draw(&canvas, all, 0, y, white, TEXT); });
+        snprintf(stage, sizeof(stage), "atlas %s (SetPixel)", f.first.c_str());
+        Time(stage, s, iterations, NoSetup, [&](int) { atlas.Draw(&generic, all, 0, y, white, TEXT); });
+        snprintf(stage, sizeof(stage), "atlas build %s", f.first.c_str());
+        Time(stage, PanelSize{ 0, 0 }, std::min(iterations, 50), NoSetup, [&](int) { GlyphAtlas a(*f.second); });
+    }
+}
+
+// Track titles as they come from Spotify: plain ASCII, Latin-1 accents, CJK and emoji
+const char *const TRACK_CORPUS[] = {
+    "Bohemian Rhapsody - Remastered 2011",
+    "Smells Like Teen Spirit",
+    "Hey Jude",
+    "Billie Jean",
+    "Bésame Mucho",
+    "Déjà Vu (feat. Ñengo Flow)",
+    "Für Elise, WoO 59",
+    "Ça plane pour moi",
+    "Sigur Rós - Hoppípolla",
+    "夜に駆ける",
+    "紅蓮華 (TV Size)",
+    "강남스타일 (Gangnam Style)",
+    "千与千寻 - 那个日子",
+    "Dynamite 🔥💥",
+    "🎵 Lo-fi beats to relax/study to 🎧",
+    "Happy 😊 (From \"Despicable Me 2\")",
+    "A much longer track title that has to scroll across several panels (Remastered 2011)",
+    "Für Dich 💕 愛してる",
+};
+
+// TextMeasurer over the corpus, one sample per pass over every title. Cold starts each
+// pass with a new measurer (no glyph widths, no memo); glyphs warm has the widths cached but
+// misses the memo, since the corpus is bigger than its slots; memo warm re-measures one title.
+void RunTextMeasurer(const rgb_matrix::Font &font, int iterations) {
+    const int count = sizeof(TRACK_CORPUS) / sizeof(TRACK_CORPUS[0]);
+    std::vector<std::string> corpus(TRACK_CORPUS, TRACK_CORPUS + count);
+    size_t bytes = 0;
+    for (const std::string &t : corpus) bytes += t.size();
+
+    printf("\nTextMeasurer, %d titles (%zu bytes) per pass\n", count, bytes);
+    PrintHeader();
+    const PanelSize none = { 0, 0 };
+    auto report = [&](double ns, int strings, size_t n) {
+        printf("%-28s %.1f M strings/s, %.0f MB/s\n", "", strings * 1e3 / ns, n * 1e3 / ns);
+    };
+    int sink = 0;
+
+    std::unique_ptr<TextMeasurer> cold;
+    double ns = Time("measure corpus (cold)", none, std::min(iterations, 200),
+                     [&](int) { cold = std::make_unique<TextMeasurer>(font); },
+                     [&](int) { for (const std::string &t : corpus) sink += cold->Width(t); });
+    report(ns, count, bytes);
+
+    TextMeasurer warm(font);
+    for (const std::string &t : corpus) sink += warm.Width(t);
+    ns = Time("measure corpus (glyphs warm)", none, iterations, NoSetup,
+              [&](int) { for (const std::string &t : corpus) sink += warm.Width(t); });
+    report(ns, count, bytes);
+
+    ns = Time("measure title (memo warm)", none, iterations, NoSetup,
+              [&](int) { sink += warm.Width(corpus[0]); });
+    report(ns, 1, corpus[0].size());
+    if (sink == 1) printf("\n"); // keep the widths from being optimized out
+}
+
+// MQTT flood: one thread dispatches a mix of topics as fast as it can (mosquitto delivers on a
+// single thread) while the render thread snapshots in a loop. Dispatch time includes parsing
+// and the writer lock, so its max bounds the worst-case lock hold.
+void RunDispatchFlood(int iterations) {
+    SharedState state;
+    TopicDispatcher d;
+    d.AddEnum<IconId>("matrix/weather/cond", ResolveWeatherIcon,
+                      [&](IconId icon, std::string_view cond) { return state.SetWeatherCond(cond, icon); });
+    d.AddString("matrix/weather/temp",   [&](std::string_view v) { return state.Set(F_WEATHER_TEMP, v); });
+    d.AddString("matrix/spotify/track",  [&](std::string_view v) { return state.Set(F_TRACK, v); });
+    d.AddString("matrix/spotify/artist", [&](std::string_view v) { return state.Set(F_ARTIST, v); });
+    d.AddInt("matrix/control/brightness", 5, 100, [&](int b) { return state.SetBrightness(b); });
+
+    struct Msg { const char *topic, *payload; };
+    const Msg MIX[] = {
+        { "matrix/weather/cond", "rainy" },       { "matrix/weather/cond", "partlycloudy" },
+        { "matrix/weather/temp", "21.5" },        { "matrix/weather/temp", "22" },
+        { "matrix/spotify/track", SHORT_TEXT },   { "matrix/spotify/track", LONG_TEXT },
+        { "matrix/spotify/artist", "Artist" },    { "matrix/spotify/artist", "Another artist" },
+        { "matrix/control/brightness", "40" },    { "matrix/control/brightness", "80" },
+        { "matrix/control/brightness", "bogus" }, { "matrix/control/brightness", "99999999999" },
+        { "matrix/unknown/topic", "x" },
+    };
+    const int MIX_N = sizeof(MIX) / sizeof(MIX[0]);
+    const int messages = iterations * 100;
+
+    std::atomic<bool> done{false};
+    LatencyHistogram snap;
+    std::thread reader([&] {
+        StateData s;
+        while (!done.load(std::memory_order_relaxed)) {
+            const int64_t t0 = NowNs();
+            state.Snapshot(s);
+            snap.Record(NowNs() - t0);
+        }
+    });
+
+    LatencyHistogram dispatch;
+    int changed = 0, rejected = 0;
+    const int64_t start = NowNs();
+    for (int i = 0; i < messages; ++i) {
+        const Msg &m = MIX[i % MIX_N];
+        const int64_t t0 = NowNs();
+        const DispatchResult r = d.Dispatch(m.topic, m.payload, strlen(m.payload));
+        dispatch.Record(NowNs() - t0);
+        changed  += r == DISPATCH_CHANGED;
+        rejected += r == DISPATCH_BAD_PAYLOAD;
+    }
+    const int64_t elapsed = NowNs() - start;
+    done = true;
+    reader.join();
+
+    printf("\nMQTT flood: %d messages (%d changed state, %d rejected) in %.1f ms, %.0f messages/s\n",
+           messages, changed, rejected, elapsed / 1e6, elapsed > 0 ? messages * 1e9 / elapsed : 0.0);
+    const PanelSize none = { 0, 0 };
+    PrintHeader();
+    PrintRow("dispatch (incl. lock)", none, dispatch);
+    PrintRow("snapshot during flood", none, snap);
+}
+
+}
+
+namespace {
+
+// What a dedup hit saves. SwapOnVSync blocks until the library's refresh thread finishes
+// scanning out the frame it is on, half a refresh on average, and that can't be timed
+// without a panel. It's emulated here with a thread ticking at an assumed refresh rate
+// (--led-show-refresh prints the real one) and a swap that waits for its next tick.
+void RunSwapCost(double keyNs, double rgbNs, int iterations) {
+    const int REFRESH_HZ = 200;
+    const int64_t refresh_ns = 1000000000LL / REFRESH_HZ;
+    printf("\nDedup hit against a swap, %d Hz refresh emulated\n", REFRESH_HZ);
+    PrintHeader();
+
+    std::mutex m;
+    std::condition_variable cv;
+    uint64_t vsync = 0;
+    std::atomic<bool> stop{false};
+    std::thread refresh([&] {
+        for (int64_t next = NowNs() + refresh_ns; !stop; next += refresh_ns) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(next - NowNs()));
+            {
+                std::lock_guard<std::mutex> lk(m);
+                ++vsync;
+            }
+            cv.notify_all();
+        }
+    });
+    const PanelSize none = { 0, 0 };
+    const double swapNs = Time("swap (emulated VSync)", none, std::min(iterations, REFRESH_HZ), [&](int) {
+        // Land anywhere in the refresh, as a frame finished by the render loop would
+        std::this_thread::sleep_for(std::chrono::nanoseconds(rand() % refresh_ns));
+    }, [&](int) {
+        std::unique_lock<std::mutex> lk(m);
+        const uint64_t v = vsync;
+        cv.wait(lk, [&] { return vsync != v; });
+    });
+    stop = true;
+    refresh.join();
+    printf("a dedup hit costs %.0f ns (frame key) or %.0f ns (shm RGB) instead of a %.0f ns swap\n",
+           keyNs, rgbNs, swapNs);
+}
+
+// What FrameTelemetry costs the render loop: the clock reads and records of one shown frame
+// (the most any frame does), and one Report over a full 10 s window at 60 Hz, spread over
+// the frames of that window. Compared against the 60 Hz frame budget.
+void RunTelemetryOverhead(int iterations) {
+    printf("\nTelemetry overhead\n");
+#if MATRIX_TELEMETRY
+    PrintHeader();
+    const PanelSize none = { 0, 0 };
+    const int WINDOW_FRAMES = 600; // 10 s at 60 Hz
+    const int64_t WINDOW_NS = 10LL * 1000000000LL;
+    FrameTelemetry tele(WINDOW_NS);
+    tele.Start(0);
+    int64_t sink = 0;
+    const double frame = Time("telemetry, one frame", none, iterations, NoSetup, [&](int i) {
+        const int64_t t_snap = TelemetryNow();
+        tele.Record(FrameTelemetry::T_SNAPSHOT, TelemetryNow() - t_snap);
+        tele.Record(FrameTelemetry::T_LATE, i & 1023);
+        tele.FramesSkipped(0);
+        const int64_t t_render = TelemetryNow();
+        const int64_t t_swap = TelemetryNow();
+        const int64_t t_shown = TelemetryNow();
+        tele.Record(FrameTelemetry::T_RENDER, t_swap - t_render);
+        tele.Record(FrameTelemetry::T_SWAP, t_shown - t_swap);
+        tele.Record(FrameTelemetry::T_LATENCY, t_shown - t_snap);
+        tele.FrameShown();
+    });
+    const double report = Time("telemetry, report", none, std::max(1, iterations / 10),
+        [&](int i) {
+            for (int k = 0; k < WINDOW_FRAMES; ++k) {
+                for (int m = 0; m < FrameTelemetry::T_COUNT; ++m) tele.Record((FrameTelemetry::Metric)m, 1000 * (k + i));
+                tele.FrameShown();
+            }
+        },
+        [&](int) { sink += (int64_t)tele.Report(WINDOW_NS).size(); });
+    const double per_frame = frame + report / WINDOW_FRAMES;
+    printf("%.0f ns per frame with the report spread over %d frames, %.4f%% of a 60 Hz frame (%lld B reported)\n",
+           per_frame, WINDOW_FRAMES, 100.0 * per_frame / FRAME_60HZ_NS, (long long)sink);
+#else
+    printf("compiled out (MATRIX_TELEMETRY=0)\n");
+    (void)iterations;
+#endif
+}
+
+// Stress payloads carry their round and a body derived from it, so a torn or mixed-up copy
+// is detectable: "<tag><round>:" then (round % 61) copies of one letter. Lengths vary so
+// the strings keep reallocating. Returns the round, or -1 if the string isn't well formed.
+std::string StressValue(char tag, int round) {
+    return tag + std::to_string(round) + ":" + std::string(round % 61, (char)('a' + round % 26));
+}
+
+int StressRound(const std::string &s, char tag) {
+    if (s.empty() || s[0] != tag) return -1;
+    const size_t colon = s.find(':');
+    if (colon == std::string::npos || colon < 2) return -1;
+    const int round = atoi(s.c_str() + 1);
+    return s == StressValue(tag, round) ? round : -1;
+}
+
+// One phase of the stress test: the writer runs `rounds` rounds against a reader that
+// snapshots until the writer is done. A window of 0 never times out, so every commit of the
+// group is a full one and track and artist must always match. A short window lets the
+// reader's CommitExpired publish half groups too, from the render thread.
+int StressPhase(int rounds, int64_t window_ns) {
+    SharedState state;
+    const bool strict = window_ns == 0;
+    state.SetCoalescing(FieldBit(F_TRACK) | FieldBit(F_ARTIST), strict ? 3600LL * 1000000000LL : window_ns);
+
+    std::atomic<bool> done{false};
+    std::thread writer([&] {
+        for (int i = 1; i <= rounds; ++i) {
+            state.Set(F_TRACK, StressValue('T', i));
+            // A timed-out group in the loose phase now and then: track alone, artist later
+            if (!strict && i % 64 == 0) std::this_thread::sleep_for(std::chrono::microseconds(200));
+            state.Set(F_ARTIST, StressValue('A', i));
+            state.Set(F_WEATHER_TEMP, StressValue('W', i));
+            if (i % 3 == 0) state.SetWeatherCond(i % 2 ? "rainy" : "snowy", i % 2 ? ICON_RAIN : ICON_SNOW);
+            if (i % 5 == 0) state.SetBrightness(5 + i % 96);
+        }
+        done = true;
+    });
+
+    int errors = 0;
+    long long snapshots = 0;
+    auto fail = [&](const char *what, const StateData &s) {
+        if (++errors <= 5) {
+            fprintf(stderr, "snapshot %lld: %s (track '%s', artist '%s', version %u)\n", snapshots, what,
+                    s.track.c_str(), s.artist.c_str(), s.version);
+        }
+    };
+
+    StateData s, prev;
+    bool first = true;
+    while (true) {
+        const bool finished = done.load();
+        state.CommitExpired(NowNs());
+        const bool fresh = state.Snapshot(s);
+        ++snapshots;
+        const int track = s.track.empty() ? 0 : StressRound(s.track, 'T');
+        const int artist = s.artist.empty() ? 0 : StressRound(s.artist, 'A');
+        if (track < 0 || artist < 0) fail("torn track or artist", s);
+        if (!s.weatherTemp.empty() && StressRound(s.weatherTemp, 'W') < 0) fail("torn temperature", s);
+        if (strict && track != artist) fail("track and artist from different commits", s);
+        if (!s.weatherCond.empty() &&
+            s.weatherIcon != (s.weatherCond == "rainy" ? ICON_RAIN : ICON_SNOW)) fail("condition and icon disagree", s);
+        if (!first) {
+            if (s.version < prev.version) fail("version went backwards", s);
+            if (!fresh && s.version != prev.version) fail("changed without being fresh", s);
+            for (int f = 0; f < F_COUNT; ++f) {
+                if (s.gen[f] < prev.gen[f]) fail("generation went backwards", s);
+                const bool same = kStringFields[f] ? s.*kStringFields[f] == prev.*kStringFields[f]
+                                                   : s.brightness == prev.brightness;
+                if (s.gen[f] == prev.gen[f] && !same) fail("value changed without its generation", s);
+            }
+            if (StressRound(s.track, 'T') < StressRound(prev.track, 'T')) fail("track went backwards", s);
+            if (StressRound(s.artist, 'A') < StressRound(prev.artist, 'A')) fail("artist went backwards", s);
+        }
+        prev = s;
+        first = false;
+        if (finished) break;
+    }
+    writer.join();
+
+    // Everything the writer sent must be on screen once it's done
+    StateData last;
+    state.CommitExpired(INT64_MAX);
+    state.Snapshot(last);
+    if (StressRound(last.track, 'T') != rounds || StressRound(last.artist, 'A') != rounds) fail("last round lost", last);
+
+    printf("%-28s %d rounds, %lld snapshots, %d inconsistent\n",
+           strict ? "full groups only" : "groups timing out", rounds, snapshots, errors);
+    return errors;
+}
+
+}
+
+int RunStateStress(int rounds) {
+    printf("SharedState stress, writer thread vs snapshotting reader\n");
+    const int errors = StressPhase(rounds, 0) + StressPhase(rounds, 100 * 1000);
+    return errors == 0 ? 0 : 1;
+}
+
+int RunRenderBenchmarks(const rgb_matrix::Font &font, const char *font_path, int iterations) {
+    printf("ns per op, %d iterations per stage\n", iterations);
+    PrintHeader();
+
+    const Color yellow(255,255,0), cyan(0,255,255), white(255,255,255);
+    double dedupKeyNs = 0, dedupRgbNs = 0; // at the largest size, against the swap below
+    const int baseline = font.baseline();
+
+    for (const PanelSize &s : SIZES) {
+        SoftwareCanvas canvas(s.w, s.h);
+        ForwardingCanvas generic(&canvas);
+
+        // State snapshot: unchanged is the common case between scroll frames, changed is a
+        // string copy after an MQTT update
+        SharedState state;
+        StateData snap;
+        state.Snapshot(snap);
+        Time("snapshot (unchanged)", s, iterations, NoSetup, [&](int) { state.Snapshot(snap); });
+        Time("snapshot (track changed)", s, iterations,
+             [&](int i) { state.Set(F_TRACK, (i & 1) ? SHORT_TEXT : LONG_TEXT); },
+             [&](int) { state.Snapshot(snap); });
+
+        // Icon blit against the old per-pixel loop, fully visible, half clipped and fully off
+        // screen. The clipped blit writes row spans, straight into a SoftwareCanvas's rows or
+        // through SetPixel on anything else (like FrameCanvas). "icon spans" goes through the
+        // generic SetPixel path, so it should never come out slower than "icon per-pixel".
+        const Icon16 *rain = GetIcon(ICON_RAIN);
+        struct { const char *name; int x, y; } const PLACES[] = {
+            { "visible", 0, 0 }, { "clipped", s.w - 8, s.h - 8 },
+            { "off right", s.w, 0 }, { "off left", -16, 0 },
+        };
+        for (const auto &p : PLACES) {
+            const std::string where = std::string(" (") + p.name + ")";
+            Time(("icon per-pixel" + where).c_str(), s, iterations, NoSetup,
+                 [&](int) { BlitIconPerPixel(rain, &generic, p.x, p.y); });
+            Time(("icon spans" + where).c_str(), s, iterations, NoSetup,
+                 [&](int) { BlitIcon(rain, &generic, p.x, p.y); });
+            Time(("icon spans sw" + where).c_str(), s, iterations, NoSetup,
+                 [&](int) { BlitIcon(rain, &canvas, p.x, p.y); });
+        }
+
+        // Same blit through a color table (gamma, white balance, dim brightness), against the
+        // plain copy above
+        ColorCalibration cal;
+        cal.gamma = 1.8f;
+        cal.white[2] = 0.85f;
+        ColorLut lut;
+        lut.Build(cal, 20);
+        Time("icon blit (color LUT)", s, iterations, NoSetup,
+             [&](int) { BlitIcon(GetIcon(ICON_RAIN), &canvas, 0, 0, BLIT_OPAQUE, &lut); });
+
+        // Static text through the font, as the temperature and summary are drawn
+        Time("DrawText temp", s, iterations, NoSetup,
+             [&](int) { DrawText(&canvas, font, 18, 10, yellow, nullptr, "21.5C"); });
+        Time("DrawText summary", s, iterations, NoSetup,
+             [&](int) { DrawText(&canvas, font, 0, 22, cyan, nullptr, "Partly cloudy, light"); });
+
+        // Marquee line from a pre-rasterized strip, short (fits) and long (two copies, wrapping)
+        TextMeasurer measure(font);
+        const int shortW = measure.Width(SHORT_TEXT);
+        const int longW = measure.Width(LONG_TEXT) + 10;
+        GlyphAtlas atlas(font);
+        TextStrip shortStrip, longStrip;
+        shortStrip.Rasterize(atlas, SHORT_TEXT, shortW);
+        longStrip.Rasterize(atlas, LONG_TEXT, longW);
+        const Rect band = MakeRect(0, s.h - 12 - baseline, s.w, font.height());
+        Time("scroll line (short)", s, iterations, NoSetup,
+             [&](int) { shortStrip.Draw(&canvas, band, 0, s.h - 12, white); });
+        Time("scroll line (long)", s, iterations, NoSetup,
+             [&](int i) { longStrip.Draw(&canvas, band, -(i % longW), s.h - 12, white, 2); });
+        Time("scroll line (long, subpixel)", s, iterations, NoSetup,
+             [&](int i) { longStrip.Draw(&canvas, band, -(i % longW), s.h - 12, white, 2, 128); });
+        Time("scroll line (subpixel, LUT)", s, iterations, NoSetup,
+             [&](int i) { longStrip.Draw(&canvas, band, -(i % longW), s.h - 12, white, 2, 128, &lut); });
+
+        // Whole frames through the renderer: a full repaint, and a steady-state scroll frame at
+        // 60 Hz where only the marquee bands are damaged (at 20 px/s most positions are fractional)
+        SharedState fstate;
+        fstate.SetWeatherCond("rainy", ResolveWeatherIcon("rainy"));
+        fstate.Set(F_WEATHER_TEMP, "21.5");
+        fstate.Set(F_WEATHER_SUMMARY, "Partly cloudy, light");
+        fstate.Set(F_TRACK, LONG_TEXT);
+        fstate.Set(F_ARTIST, "Artist");
+        StateData fsnap;
+        fstate.Snapshot(fsnap);
+        DisplayRenderer renderer(font, s.w, s.h);
+        renderer.Update(fsnap);
+        renderer.Draw(&canvas);
+        Time("full frame (repaint all)", s, iterations, NoSetup, [&](int) {
+            renderer.DamageAll();
+            renderer.Update(fsnap);
+            renderer.Draw(&canvas);
+        });
+        Time("full frame (scroll tick)", s, iterations, NoSetup, [&](int i) {
+            renderer.Tick(i * FRAME_60HZ_NS);
+            if (renderer.Update(fsnap)) renderer.Draw(&canvas);
+        });
+
+        // Telling a frame from the one on screen before the swap: the renderer's frame key,
+        // the RGB hash the shm input takes of each frame, and for comparison a hash of a
+        // FrameCanvas at the default 11 bit planes (a 32-bit word per pixel pair per plane)
+        uint64_t sink = 0;
+        std::vector<uint8_t> planes((size_t)s.w * (s.h / 2) * 11 * 4, 0x5a);
+        dedupKeyNs = Time("dedup frame key", s, iterations, NoSetup,
+                          [&](int) { sink ^= renderer.FrameKey(); });
+        dedupRgbNs = Time("dedup hash (shm RGB)", s, iterations, NoSetup,
+                          [&](int) { sink ^= HashFrame(canvas.data(), canvas.size()); });
+        Time("hash (11 planes)", s, iterations, NoSetup,
+             [&](int) { sink ^= HashFrame(planes.data(), planes.size()); });
+        if (sink == 1) printf("\n"); // keep the hashes from being optimized out
+    }
+    RunSwapCost(dedupKeyNs, dedupRgbNs, iterations);
+    RunGlyphAtlas(font, font_path, iterations);
+    RunTextMeasurer(font, iterations);
+    RunTiledScaling(font, iterations);
+    RunDispatchFlood(iterations);
+    RunTelemetryOverhead(iterations);
+    return 0;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <rpi-rgb-led-matrix/include/graphics.h>
+
+// Render microbenchmarks, run from the headless build with --bench.
+// Times each stage of the render path in isolation on a SoftwareCanvas at several panel
+// sizes and prints ns/op percentiles, so changes can be compared across releases.
+// font_path is where font was loaded from; larger fonts next to it are used for the text
+// comparisons if present. Returns a process exit code.
+int RunRenderBenchmarks(const rgb_matrix::Font &font, const char *font_path, int iterations);
+
+// SharedState stress test, run from the headless build with --stress. One thread plays the
+// MQTT side (Set, grouped track/artist through HoldLocked/CommitLocked, brightness) for
+// `rounds` rounds while the render side snapshots in a loop and checks every snapshot: no
+// torn strings, track and artist from the same commit, generations and versions that never
+// go backwards and values that only change with their generation. Returns 0 if every
+// snapshot was consistent, 1 otherwise.
+int RunStateStress(int rounds);
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+
+// Brightness as its own animated channel. A new target fades in over a fixed time instead
+// of jumping, and the render loop only touches the matrix when the level actually changes.
+//
+// Levels are the library's brightness percent. The library maps each pixel through CIE1931
+// lightness with brightness as a lightness scale, so stepping the percent linearly in time
+// is already a perceptually even fade; no further curve is needed here.
+//
+// Every step repaints the panel (brightness is applied as pixels are set), so steps are at
+// least min_step_ns apart: a long fade moves a percent at a time, a short one skips levels.
+// Render thread only.
+class BrightnessRamp {
+public:
+    BrightnessRamp(int64_t duration_ns, int64_t min_step_ns)
+        : duration_(duration_ns), min_step_(min_step_ns) {}
+
+    // Fade from the level on screen to target. The first target is taken straight away.
+    void SetTarget(int target, int64_t now) {
+        if (target == to_) return;
+        if (level_ < 0 || duration_ <= 0) {
+            from_ = level_ = to_ = target;
+            deadline_ = now; // apply on the next render
+            return;
+        }
+        from_  = level_;
+        to_    = target;
+        start_ = now;
+        deadline_ = now;
+    }
+
+    int target() const { return to_; }
+
+    // When the level next needs to change, or -1 once the fade has finished
+    int64_t deadline() const { return deadline_; }
+    bool Due(int64_t now) const { return deadline_ >= 0 && now >= deadline_; }
+
+    // Level to show at now. Schedules the next step.
+    int Level(int64_t now) {
+        if (deadline_ < 0 || level_ == to_) {
+            level_ = to_;
+            deadline_ = -1;
+            return level_;
+        }
+        const int span = std::abs(to_ - from_);
+        const int64_t elapsed = now - start_;
+        if (elapsed >= duration_) {
+            level_ = to_;
+            deadline_ = -1;
+            return level_;
+        }
+        // Round to the nearest level, then wake when the next one is reached
+        const int steps = (int)((elapsed * span + duration_ / 2) / duration_);
+        level_ = from_ + (to_ > from_ ? steps : -steps);
+        if (level_ == to_) {
+            deadline_ = -1;
+            return level_;
+        }
+        const int64_t next = start_ + ((2 * steps + 1) * duration_ + 2 * span - 1) / (2 * span);
+        deadline_ = next > now + min_step_ ? next : now + min_step_;
+        return level_;
+    }
+
+private:
+    int64_t duration_;
+    int64_t min_step_;
+    int from_ = -1, to_ = -1;
+    int level_ = -1;          // level last returned
+    int64_t start_ = 0;
+    int64_t deadline_ = -1;
+};
@@ -0,0 +1,32 @@
+#include "color_lut.h"
+#include <cmath>
+
+namespace {
+
+// Smallest channel value the library still lights at a brightness. It scales each value to
+// lightness c * brightness / 255 (0..100) and maps that to 11 bit planes of luminance, where
+// anything under about 0.22 L* rounds to zero.
+int MinVisible(int brightness) {
+    if (brightness < 1) brightness = 1;
+    return (int)std::ceil(56.2 / brightness);
+}
+
+}
+
+void ColorLut::Build(const ColorCalibration &cal, int brightness) {
+    const int floor = MinVisible(brightness);
+    const bool curve = cal.gamma != 1.0f;
+    identity_ = true;
+    for (int c = 0; c < 3; ++c) {
+        const float gain = cal.white[c] < 0 ? 0 : cal.white[c] > 1 ? 1 : cal.white[c];
+        lut_[c][0] = 0;
+        for (int v = 1; v < 256; ++v) {
+            const float x = v / 255.0f;
+            int out = (int)((curve ? std::pow(x, cal.gamma) : x) * gain * 255.0f + 0.5f);
+            if (gain > 0 && out < floor) out = floor;
+            if (out > 255) out = 255;
+            lut_[c][v] = (uint8_t)out;
+            if (out != v) identity_ = false;
+        }
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <rpi-rgb-led-matrix/include/graphics.h>
+
+// Panel calibration, applied on top of the library's own CIE1931 mapping
+struct ColorCalibration {
+    float gamma = 1.0f;              // > 1 darkens midtones, < 1 lifts them
+    float white[3] = { 1, 1, 1 };    // per-channel gain 0..1, e.g. to tame a blue-heavy panel
+};
+
+// Color correction baked into one 256-entry table per channel. Assets are authored at full
+// range in plain RGB; every icon blit, text span and bar goes through the table on its way
+// to the canvas, which costs three byte loads per pixel.
+//
+// The table is rebuilt only when the calibration or the brightness changes. Besides gamma
+// and white balance it holds the brightness-dependent part: at low brightness the library's
+// bit planes round dim channel values to zero, so any non-zero value is lifted to the
+// smallest one that still lights at that brightness, and dark greys and shading don't vanish.
+class ColorLut {
+public:
+    ColorLut() { Build(ColorCalibration(), 100); }
+
+    // brightness is the library's percent, 1..100
+    void Build(const ColorCalibration &cal, int brightness);
+
+    // True when every table maps a value to itself, so callers can copy pixels unchanged
+    bool identity() const { return identity_; }
+
+    uint8_t r(uint8_t v) const { return lut_[0][v]; }
+    uint8_t g(uint8_t v) const { return lut_[1][v]; }
+    uint8_t b(uint8_t v) const { return lut_[2][v]; }
+    rgb_matrix::Color Map(const rgb_matrix::Color &c) const {
+        return rgb_matrix::Color(lut_[0][c.r], lut_[1][c.g], lut_[2][c.b]);
+    }
+
+private:
+    uint8_t lut_[3][256];
+    bool identity_ = true;
+};
@@ -0,0 +1,127 @@
+#pragma once
+#include <cstdint>
+#include <algorithm>
+#include "canvas.h"
+
+// Damage tracking helpers for the render loop.
+// Instead of clearing and repainting the whole panel each frame, every element
+// records the box it last drew into. When it changes, its old and new boxes are
+// added to a DamageList, and only those rectangles are cleared and redrawn.
+
+// Pixel rectangle, half-open: covers x0 <= x < x1, y0 <= y < y1
+struct Rect {
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+
+    bool Empty() const { return x1 <= x0 || y1 <= y0; }
+    int Area() const { return Empty() ? 0 : (x1 - x0) * (y1 - y0); }
+};
+
+inline bool operator==(const Rect &a, const Rect &b) {
+    return a.x0 == b.x0 && a.y0 == b.y0 && a.x1 == b.x1 && a.y1 == b.y1;
+}
+inline bool operator!=(const Rect &a, const Rect &b) { return !(a == b); }
+
+inline Rect MakeRect(int x, int y, int w, int h) {
+    return Rect{x, y, x + w, y + h};
+}
+
+inline Rect Intersect(const Rect &a, const Rect &b) {
+    return Rect{std::max(a.x0, b.x0), std::max(a.y0, b.y0),
+                std::min(a.x1, b.x1), std::min(a.y1, b.y1)};
+}
+
+inline Rect Union(const Rect &a, const Rect &b) {
+    if (a.Empty()) return b;
+    if (b.Empty()) return a;
+    return Rect{std::min(a.x0, b.x0), std::min(a.y0, b.y0),
+                std::max(a.x1, b.x1), std::max(a.y1, b.y1)};
+}
+
+inline bool Overlaps(const Rect &a, const Rect &b) {
+    return !Intersect(a, b).Empty();
+}
+
+// Small fixed-size list of damaged rectangles, no allocation.
+// Overlapping rects are merged as they are added so every pixel is repainted once.
+// If it ever runs out of slots everything collapses into one bounding box.
+class DamageList {
+public:
+    static constexpr int MAX_RECTS = 8;
+
+    void Clear() { count_ = 0; }
+    bool Empty() const { return count_ == 0; }
+    int size() const { return count_; }
+    const Rect *begin() const { return rects_; }
+    const Rect *end() const { return rects_ + count_; }
+
+    void Add(Rect r) {
+        if (r.Empty()) return;
+        // Merge with anything we touch, then re-check since the union grew
+        for (int i = 0; i < count_; ) {
+            if (Overlaps(rects_[i], r)) {
+                r = Union(rects_[i], r);
+                rects_[i] = rects_[--count_];
+                i = 0;
+            } else {
+                ++i;
+            }
+        }
+        if (count_ == MAX_RECTS) {
+            for (int i = 0; i < count_; ++i) r = Union(r, rects_[i]);
+            count_ = 0;
+        }
+        rects_[count_++] = r;
+    }
+
+    void Add(const DamageList &other) {
+        for (const Rect &r : other) Add(r);
+    }
+
+    int Area() const {
+        int a = 0;
+        for (const Rect &r : *this) a += r.Area();
+        return a;
+    }
+
+private:
+    Rect rects_[MAX_RECTS];
+    int count_ = 0;
+};
+
+// Fill a rectangle (clipped to the canvas) with one color
+inline void FillRect(rgb_matrix::Canvas *canvas, Rect r,
+                     uint8_t red, uint8_t green, uint8_t blue) {
+    r = Intersect(r, MakeRect(0, 0, canvas->width(), canvas->height()));
+    for (int y = r.y0; y < r.y1; ++y)
+        for (int x = r.x0; x < r.x1; ++x)
+            canvas->SetPixel(x, y, red, green, blue);
+}
+
+// Canvas wrapper that drops every pixel outside a clip rectangle.
+// Lets DrawText and friends repaint an element into one damaged region without
+// touching pixels that belong to neighbouring (unchanged) elements.
+class ClipCanvas : public rgb_matrix::Canvas {
+public:
+    ClipCanvas(rgb_matrix::Canvas *inner, const Rect &clip)
+        : inner_(inner),
+          clip_(Intersect(clip, MakeRect(0, 0, inner->width(), inner->height()))) {}
+
+    rgb_matrix::Canvas *inner() const { return inner_; }
+    const Rect &clip() const { return clip_; }
+
+    int width() const override { return inner_->width(); }
+    int height() const override { return inner_->height(); }
+
+    void SetPixel(int x, int y, uint8_t red, uint8_t green, uint8_t blue) override {
+        if (x < clip_.x0 || x >= clip_.x1 || y < clip_.y0 || y >= clip_.y1) return;
+        inner_->SetPixel(x, y, red, green, blue);
+    }
+    void Clear() override { FillRect(inner_, clip_, 0, 0, 0); }
+    void Fill(uint8_t red, uint8_t green, uint8_t blue) override {
+        FillRect(inner_, clip_, red, green, blue);
+    }
+
+private:
+    rgb_matrix::Canvas *inner_;
+    Rect clip_;
+};
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+// Content hash of an RGB frame or any other block of pixels, to tell a frame identical to the
+// one on screen (e.g. a shm producer sending the same frame again) from a real change, so the
+// swap and its wait for VSync can be skipped.
+//
+// FNV-1a over 32-bit words, in 16 independent lanes held in four 128-bit vectors (GCC vector
+// extensions, so NEON on the Pi and SSE elsewhere, at -O2 too). Four vectors keep the
+// multiplier busy while each one waits on its previous multiply. Each step of a lane is a
+// bijection, so frames differing in a single word always hash differently.
+inline uint64_t HashFrame(const void *data, size_t len) {
+    typedef uint32_t Lanes __attribute__((vector_size(16)));
+    constexpr int VECTORS = 4;
+    constexpr uint32_t PRIME32 = 16777619u;
+    constexpr uint64_t PRIME64 = 0x100000001b3ULL;
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+
+    Lanes v[VECTORS];
+    for (int k = 0; k < VECTORS; ++k) {
+        const uint32_t basis = 2166136261u + 4 * k;
+        v[k] = Lanes{ basis, basis + 1, basis + 2, basis + 3 };
+    }
+    size_t i = 0;
+    for (; i + sizeof(v) <= len; i += sizeof(v)) {
+        Lanes w[VECTORS];
+        memcpy(w, p + i, sizeof(w));
+        for (int k = 0; k < VECTORS; ++k) v[k] = (v[k] ^ w[k]) * PRIME32;
+    }
+
+    // Fold the lanes and whatever didn't fill a whole block into 64 bits
+    uint64_t h = 0xcbf29ce484222325ULL ^ len;
+    for (int k = 0; k < VECTORS; ++k) {
+        for (int l = 0; l < 4; ++l) h = (h ^ v[k][l]) * PRIME64;
+    }
+    for (; i < len; ++i) h = (h ^ p[i]) * PRIME64;
+    return h;
+}
+
+// Folds v into hash h (the murmur3 finalizer over h ^ v), for building a frame key out of a
+// few scalars such as positions, sub-hashes and the brightness level. Every bit of v reaches
+// every bit of the result.
+inline uint64_t HashMix(uint64_t h, uint64_t v) {
+    h ^= v;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Remembers the hash of the frame on screen. Render thread only.
+class FrameDedup {
+public:
+    // True if a frame with this hash is already on screen, so it needn't be swapped in.
+    // Otherwise remembers it as the frame about to be shown.
+    bool OnScreen(uint64_t hash) {
+        if (known_ && hash == shown_) return true;
+        shown_ = hash;
+        known_ = true;
+        return false;
+    }
+
+private:
+    uint64_t shown_ = 0;
+    bool known_ = false;
+};
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+// Fixed-size log-linear latency histogram (HDR style): 64 power-of-two ranges split into
+// 16 linear sub-buckets each, so any recorded value is reported to within ~6%.
+// Record() is a couple of shifts and an increment, no allocation, so it is cheap enough to
+// leave on in the render loop as well as in benchmarks.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr int NUM_BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+    LatencyHistogram() { Reset(); }
+
+    void Reset() {
+        memset(counts_, 0, sizeof(counts_));
+        count_ = 0;
+        sum_ = 0;
+        min_ = INT64_MAX;
+        max_ = 0;
+    }
+
+    void Record(int64_t value) {
+        if (value < 0) value = 0;
+        ++counts_[BucketOf((uint64_t)value)];
+        ++count_;
+        sum_ += value;
+        if (value < min_) min_ = value;
+        if (value > max_) max_ = value;
+    }
+
+    uint64_t count() const { return count_; }
+    int64_t min() const { return count_ ? min_ : 0; }
+    int64_t max() const { return max_; }
+    double mean() const { return count_ ? (double)sum_ / count_ : 0.0; }
+
+    // Value at percentile p (0-100), reported as the upper edge of its bucket
+    int64_t Percentile(double p) const {
+        if (count_ == 0) return 0;
+        uint64_t rank = (uint64_t)(p / 100.0 * count_ + 0.5);
+        if (rank < 1) rank = 1;
+        if (rank > count_) rank = count_;
+        uint64_t seen = 0;
+        for (int b = 0; b < NUM_BUCKETS; ++b) {
+            seen += counts_[b];
+            if (seen >= rank) {
+                const int64_t upper = (int64_t)UpperEdge(b);
+                return upper < max_ ? upper : max_;
+            }
+        }
+        return max_;
+    }
+
+private:
+    // Values below SUB_BUCKETS get a bucket each, above that each power of two is split in 16
+    static int BucketOf(uint64_t v) {
+        if (v < SUB_BUCKETS) return (int)v;
+        const int msb = 63 - __builtin_clzll(v);
+        const int shift = msb - SUB_BITS;
+        return (shift + 1) * SUB_BUCKETS + (int)((v >> shift) & (SUB_BUCKETS - 1));
+    }
+
+    static uint64_t UpperEdge(int bucket) {
+        if (bucket < SUB_BUCKETS) return (uint64_t)bucket;
+        const int shift = bucket / SUB_BUCKETS - 1;
+        const uint64_t sub = (uint64_t)(bucket % SUB_BUCKETS) | SUB_BUCKETS;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    uint32_t counts_[NUM_BUCKETS];
+    uint64_t count_;
+    int64_t sum_;
+    int64_t min_;
+    int64_t max_;
+};
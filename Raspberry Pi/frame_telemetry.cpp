@@ -0,0 +1,41 @@
+#include "frame_telemetry.h"
+
+#if MATRIX_TELEMETRY
+#include <cstdio>
+
+namespace {
+
+const char *METRIC_NAMES[FrameTelemetry::T_COUNT] = { "snap", "render", "swap", "late", "latency" };
+
+}
+
+// {"window":10.0,"shown":200,"skipped":0,"dedup":0,"ttff":35.2,"render":[n,mean,p50,p99,max],...}
+// Times are in microseconds, apart from ttff (time to first frame since start) in ms.
+// Metrics with no samples in the window are left out.
+std::string FrameTelemetry::Report(int64_t now) {
+    const int64_t window = period_ - (deadline_ - now);
+    char buf[512];
+    int len = snprintf(buf, sizeof(buf), "{\"window\":%.1f,\"shown\":%llu,\"skipped\":%llu,\"dedup\":%llu",
+                       window / 1e9, (unsigned long long)shown_, (unsigned long long)skipped_,
+                       (unsigned long long)deduped_);
+    if (first_frame_ >= 0) len += snprintf(buf + len, sizeof(buf) - len, ",\"ttff\":%.1f", first_frame_ / 1e6);
+    for (int m = 0; m < T_COUNT; ++m) {
+        const LatencyHistogram &h = hist_[m];
+        if (h.count() == 0 || len >= (int)sizeof(buf)) continue;
+        len += snprintf(buf + len, sizeof(buf) - len, ",\"%s\":[%llu,%lld,%lld,%lld,%lld]",
+                        METRIC_NAMES[m], (unsigned long long)h.count(), (long long)(h.mean() / 1000),
+                        (long long)(h.Percentile(50) / 1000), (long long)(h.Percentile(99) / 1000),
+                        (long long)(h.max() / 1000));
+    }
+    std::string out(buf, len < (int)sizeof(buf) ? len : sizeof(buf) - 1);
+    out += '}';
+
+    for (LatencyHistogram &h : hist_) h.Reset();
+    shown_ = 0;
+    skipped_ = 0;
+    deduped_ = 0;
+    // Next window from now, not from the old deadline, so a long idle wait doesn't cause a burst
+    deadline_ = now + period_;
+    return out;
+}
+#endif
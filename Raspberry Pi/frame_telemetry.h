@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "render_scheduler.h"
+
+// Build with -DMATRIX_TELEMETRY=0 to compile the render loop instrumentation out entirely:
+// FrameTelemetry becomes an empty class and TelemetryNow() a constant, so no clock reads
+// or histogram updates are left in the loop.
+#ifndef MATRIX_TELEMETRY
+#define MATRIX_TELEMETRY 1
+#endif
+
+#if MATRIX_TELEMETRY
+#include "frame_stats.h"
+#endif
+
+// Clock for instrumentation only, 0 when telemetry is compiled out
+inline int64_t TelemetryNow() {
+#if MATRIX_TELEMETRY
+    return NowNs();
+#else
+    return 0;
+#endif
+}
+
+// Always-on timing for the render loop. Each metric is a LatencyHistogram over the current
+// reporting window; Report() formats the window as one compact JSON line and starts a new one.
+// Render thread only, apart from construction.
+class FrameTelemetry {
+public:
+    enum Metric {
+        T_SNAPSHOT, // SharedState::Snapshot
+        T_RENDER,   // renderer Update + Draw
+        T_SWAP,     // blocked in SwapOnVSync
+        T_LATE,     // how late the loop woke for a paced or widget frame, past its deadline
+        T_LATENCY,  // MQTT publish to the first swap showing it
+        T_COUNT
+    };
+
+#if MATRIX_TELEMETRY
+    explicit FrameTelemetry(int64_t period_ns) : period_(period_ns) {}
+
+    void Record(Metric m, int64_t ns) { hist_[m].Record(ns); }
+    void FrameShown() { ++shown_; }
+    void FramesSkipped(int n) { skipped_ += n; }
+    // A redrawn frame came out identical to the one on screen and wasn't swapped in
+    void SwapDeduped() { ++deduped_; }
+    // Time from start to the first frame shown, included in every report
+    void SetFirstFrame(int64_t ns) { first_frame_ = ns; }
+
+    // Reporting window. The first window starts at the first call to Start().
+    void Start(int64_t now) { if (deadline_ < 0) deadline_ = now + period_; }
+    int64_t deadline() const { return deadline_; }
+    bool Due(int64_t now) const { return deadline_ >= 0 && now >= deadline_; }
+
+    // Formats the window ending at `now` and resets it
+    std::string Report(int64_t now);
+
+private:
+    int64_t period_;
+    int64_t deadline_ = -1;
+    LatencyHistogram hist_[T_COUNT];
+    uint64_t shown_ = 0;
+    uint64_t skipped_ = 0;
+    uint64_t deduped_ = 0;
+    int64_t first_frame_ = -1;
+#else
+    explicit FrameTelemetry(int64_t) {}
+
+    void Record(Metric, int64_t) {}
+    void FrameShown() {}
+    void FramesSkipped(int) {}
+    void SwapDeduped() {}
+    void SetFirstFrame(int64_t) {}
+    void Start(int64_t) {}
+    int64_t deadline() const { return -1; }
+    bool Due(int64_t) const { return false; }
+    std::string Report(int64_t) { return std::string(); }
+#endif
+};
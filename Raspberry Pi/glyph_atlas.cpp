@@ -0,0 +1,139 @@
+#include "glyph_atlas.h"
+#include <algorithm>
+#include <cstring>
+#include "software_canvas.h"
+#include "text_metrics.h"
+
+namespace {
+
+constexpr int CAPTURE_WIDTH = 255; // widest advance a run can describe
+
+// Canvas that records the pixels DrawGlyph sets, with room above and below the font box
+// for glyphs that stick out of it
+class CaptureCanvas : public rgb_matrix::Canvas {
+public:
+    CaptureCanvas(int w, int h) : w_(w), h_(h), mask_((size_t)w * h, 0) {}
+    int width() const override { return w_; }
+    int height() const override { return h_; }
+    void SetPixel(int x, int y, uint8_t r, uint8_t g, uint8_t b) override {
+        if (x < 0 || x >= w_ || y < 0 || y >= h_ || !(r | g | b)) return;
+        mask_[(size_t)y * w_ + x] = 1;
+    }
+    void Clear() override { std::fill(mask_.begin(), mask_.end(), 0); }
+    void Fill(uint8_t, uint8_t, uint8_t) override {}
+
+    const uint8_t *Row(int y) const { return &mask_[(size_t)y * w_]; }
+
+private:
+    int w_, h_;
+    std::vector<uint8_t> mask_;
+};
+
+}
+
+GlyphAtlas::GlyphAtlas(const rgb_matrix::Font &font)
+    : font_(font), height_(font.height()), baseline_(font.baseline()) {
+    for (uint32_t cp = 0x20; cp < 0x100; ++cp) {
+        if (cp >= 0x7f && cp < 0xa0) continue; // control characters
+        latin1_[cp] = Capture(cp);
+    }
+}
+
+GlyphAtlas::Glyph GlyphAtlas::Capture(uint32_t codepoint) {
+    // Baseline on row 2 * height, so glyphs can reach a whole font height above the box
+    const int origin = 2 * height_;
+    CaptureCanvas cc(CAPTURE_WIDTH, 3 * height_);
+    const int advance = font_.DrawGlyph(&cc, 0, origin, rgb_matrix::Color(255, 255, 255), nullptr, codepoint);
+
+    Glyph g;
+    g.first   = (uint32_t)runs_.size();
+    g.advance = (uint8_t)std::max(0, std::min(advance, CAPTURE_WIDTH));
+    g.top     = 0;
+    g.bottom  = 0;
+    // DrawGlyph only draws inside the advance
+    const int w = g.advance;
+    for (int y = 0; y < cc.height(); ++y) {
+        const uint8_t *row = cc.Row(y);
+        const int dy = y - origin;
+        for (int x = 0; x < w;) {
+            if (!row[x]) {
+                ++x;
+                continue;
+            }
+            const int start = x;
+            while (x < w && row[x]) ++x;
+            if (g.count == 0) g.top = (int8_t)dy;
+            g.bottom = (int8_t)(dy + 1);
+            runs_.push_back(Run{ (int8_t)dy, (uint8_t)start, (uint8_t)(x - start) });
+            ++g.count;
+        }
+    }
+    g.ready = true;
+    return g;
+}
+
+const GlyphAtlas::Glyph &GlyphAtlas::Get(uint32_t codepoint) {
+    if (codepoint < 0x100 && latin1_[codepoint].ready) return latin1_[codepoint];
+    auto it = other_.find(codepoint);
+    if (it != other_.end()) return it->second;
+    return other_.emplace(codepoint, Capture(codepoint)).first->second;
+}
+
+int GlyphAtlas::Draw(rgb_matrix::Canvas *canvas, const Rect &clip, int x, int y,
+                     const rgb_matrix::Color &color, const std::string &text) {
+    // Unwrap a ClipCanvas so its clip folds into ours, as BlitIcon does
+    Rect c = clip;
+    if (auto *cc = dynamic_cast<ClipCanvas *>(canvas)) {
+        c = Intersect(c, cc->clip());
+        canvas = cc->inner();
+    }
+    c = Intersect(c, MakeRect(0, 0, canvas->width(), canvas->height()));
+    SoftwareCanvas *sw = dynamic_cast<SoftwareCanvas *>(canvas);
+
+    const int x0 = x;
+    const char *p = text.data();
+    const char *end = p + text.size();
+    while (p < end) {
+        const Glyph &g = Get(NextCodepoint(p, end));
+        const Rect box = MakeRect(x, y + g.top, g.advance, g.bottom - g.top);
+        if (g.count && Overlaps(box, c)) {
+            const bool inside = Intersect(box, c) == box;
+            const Run *run = runs_.data() + g.first;
+            for (int i = 0; i < g.count; ++i, ++run) {
+                const int yy = y + run->dy;
+                int rx0 = x + run->x, rx1 = rx0 + run->len;
+                if (!inside) {
+                    if (yy < c.y0 || yy >= c.y1) continue;
+                    rx0 = std::max(rx0, c.x0);
+                    rx1 = std::min(rx1, c.x1);
+                    if (rx0 >= rx1) continue;
+                }
+                if (sw) {
+                    sw->FillSpan(rx0, yy, rx1 - rx0, color.r, color.g, color.b);
+                } else {
+                    for (int xx = rx0; xx < rx1; ++xx) canvas->SetPixel(xx, yy, color.r, color.g, color.b);
+                }
+            }
+        }
+        x += g.advance;
+    }
+    return x - x0;
+}
+
+int GlyphAtlas::DrawMask(uint8_t *mask, int w, int h, int x, int baseline, const std::string &text) {
+    const int x0 = x;
+    const char *p = text.data();
+    const char *end = p + text.size();
+    while (p < end) {
+        const Glyph &g = Get(NextCodepoint(p, end));
+        const Run *run = runs_.data() + g.first;
+        for (int i = 0; i < g.count; ++i, ++run) {
+            const int yy = baseline + run->dy;
+            if (yy < 0 || yy >= h) continue;
+            const int rx0 = std::max(x + run->x, 0), rx1 = std::min(x + run->x + run->len, w);
+            if (rx0 < rx1) memset(mask + (size_t)yy * w + rx0, 1, rx1 - rx0);
+        }
+        x += g.advance;
+    }
+    return x - x0;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <rpi-rgb-led-matrix/include/graphics.h>
+#include "damage.h"
+
+// A BDF font converted once into horizontal runs of set pixels per glyph row.
+// DrawText asks the font for each glyph's bitmap and tests every bit through SetPixel;
+// here each glyph is captured from the font once, its rows stored as (row, x, length) runs
+// in one flat array, and drawing writes whole runs. A glyph entirely outside the clip is
+// skipped from its box without looking at its runs, and one entirely inside is drawn
+// without per-run clipping.
+//
+// Printable ASCII and Latin-1 are converted up front; anything else the first time it is
+// drawn. Lays text out exactly like DrawText (same advances, same U+FFFD fallback), with
+// UTF-8 decoded by NextCodepoint like TextMeasurer. Render thread only.
+class GlyphAtlas {
+public:
+    explicit GlyphAtlas(const rgb_matrix::Font &font);
+
+    int height() const { return height_; }
+    int baseline() const { return baseline_; }
+
+    // Draw text with the left end of its baseline at (x, y), clipped to clip and the canvas.
+    // Returns the advance, like DrawText.
+    int Draw(rgb_matrix::Canvas *canvas, const Rect &clip, int x, int y,
+             const rgb_matrix::Color &color, const std::string &text);
+
+    // Set (to 1) the bytes of a w x h coverage mask that text covers, baseline on row
+    // `baseline`, starting at column x. Returns the advance.
+    int DrawMask(uint8_t *mask, int w, int h, int x, int baseline, const std::string &text);
+
+private:
+    struct Run {
+        int8_t dy;      // row relative to the baseline
+        uint8_t x, len; // from the glyph's origin
+    };
+    struct Glyph {
+        uint32_t first = 0;  // into runs_
+        uint16_t count = 0;
+        uint8_t advance = 0;
+        int8_t top = 0, bottom = 0; // rows covered, relative to the baseline, bottom exclusive
+        bool ready = false;
+    };
+
+    const Glyph &Get(uint32_t codepoint);
+    Glyph Capture(uint32_t codepoint);
+
+    const rgb_matrix::Font &font_;
+    int height_, baseline_;
+    std::vector<Run> runs_;
+    Glyph latin1_[256];                          // converted at construction
+    std::unordered_map<uint32_t, Glyph> other_;  // converted on first use
+};
@@ -0,0 +1,176 @@
+// Headless host build of the Pi display.
+// Runs the same DisplayRenderer as main.cpp against in-memory SoftwareCanvas buffers, with no
+// matrix, no MQTT and no frame pacing, so rendering can be profiled and checked on any Linux box.
+// Frames can be dumped as a PPM stream or raw RGB24 (e.g. pipe into ffmpeg or ffplay).
+// --bench runs the per-stage render microbenchmarks instead (see bench.cpp), and --stress
+// the SharedState consistency check.
+//
+// Example:
+//   ./matrix-headless --frames=600 --track="A very long track name" --dump=- | ffplay -f image2pipe -vcodec ppm -
+#include <time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <rpi-rgb-led-matrix/include/graphics.h>
+#include "shared_state.h"
+#include "renderer.h"
+#include "software_canvas.h"
+#include "bench.h"
+#include "layout.h"
+#include "render_pool.h"
+
+static int64_t ClockNs(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Returns the value if arg is "--name=value", nullptr otherwise
+static const char *FlagValue(const char *arg, const char *name) {
+    const size_t n = strlen(name);
+    if (strncmp(arg, "--", 2) != 0 || strncmp(arg + 2, name, n) != 0 || arg[2 + n] != '=') return nullptr;
+    return arg + 3 + n;
+}
+
+static void WriteFrame(FILE *out, const SoftwareCanvas &canvas, bool ppm) {
+    if (ppm) fprintf(out, "P6\n%d %d\n255\n", canvas.width(), canvas.height());
+    fwrite(canvas.data(), 1, canvas.size(), out);
+}
+
+static int Usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --width=N --height=N   canvas size (default 64x32)\n"
+            "  --font=PATH            BDF font (default rpi-rgb-led-matrix/fonts/6x13.bdf)\n"
+            "  --frames=N             frames to render (default 1000)\n"
+            "  --fps=N                simulated frame rate the marquees move at (default 20)\n"
+            "  --dump=PATH            write displayed frames to PATH, - for stdout\n"
+            "  --format=ppm|raw       dump format (default ppm)\n"
+            "  --threads=N            render threads, tiles of --tile-width pixels (default 1)\n"
+            "  --tile-width=N         tile width for --threads (default 64, one panel)\n"
+            "  --layout=PATH          screen layout file (default: built in, see layout.h)\n"
+            "  --bench[=N]            run render microbenchmarks, N iterations per stage (default 2000)\n"
+            "  --stress[=N]           hammer SharedState from a writer thread for N rounds while checking\n"
+            "                         every snapshot; exits 1 on an inconsistent one (default 200000)\n"
+            "  --cond= --temp= --summary= --track= --artist=\n"
+            "                         state to render, as if published over MQTT\n",
+            prog);
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    int width = 64, height = 32, frames = 1000;
+    const char *font_path = "rpi-rgb-led-matrix/fonts/6x13.bdf";
+    const char *dump_path = nullptr;
+    const char *layout_path = nullptr;
+    int threads = 1, tile_width = 64;
+    int fps = 20;
+    bool ppm = true;
+    int bench_iterations = 0;
+    int stress_rounds = 0;
+
+    // Same defaults as a fresh SharedState, plus something to look at
+    SharedState state;
+    state.SetWeatherCond("partlycloudy", ResolveWeatherIcon("partlycloudy"));
+    state.Set(F_WEATHER_TEMP, "14");
+    state.Set(F_WEATHER_SUMMARY, "Light breeze");
+    state.Set(F_TRACK, "Headless render test, long enough to scroll");
+    state.Set(F_ARTIST, "Software Canvas");
+
+    for (int i = 1; i < argc; ++i) {
+        const char *a = argv[i], *v;
+        if ((v = FlagValue(a, "width")))           width = atoi(v);
+        else if ((v = FlagValue(a, "height")))     height = atoi(v);
+        else if ((v = FlagValue(a, "frames")))     frames = atoi(v);
+        else if ((v = FlagValue(a, "font")))       font_path = v;
+        else if ((v = FlagValue(a, "dump")))       dump_path = v;
+        else if ((v = FlagValue(a, "layout")))     layout_path = v;
+        else if ((v = FlagValue(a, "fps")))        fps = atoi(v);
+        else if ((v = FlagValue(a, "threads")))    threads = atoi(v);
+        else if ((v = FlagValue(a, "tile-width"))) tile_width = atoi(v);
+        else if ((v = FlagValue(a, "format")))     ppm = strcmp(v, "raw") != 0;
+        else if ((v = FlagValue(a, "bench")))      bench_iterations = atoi(v);
+        else if (strcmp(a, "--bench") == 0)        bench_iterations = 2000;
+        else if ((v = FlagValue(a, "stress")))     stress_rounds = atoi(v);
+        else if (strcmp(a, "--stress") == 0)       stress_rounds = 200000;
+        else if ((v = FlagValue(a, "cond")))       state.SetWeatherCond(v, ResolveWeatherIcon(v));
+        else if ((v = FlagValue(a, "temp")))       state.Set(F_WEATHER_TEMP, v);
+        else if ((v = FlagValue(a, "summary")))    state.Set(F_WEATHER_SUMMARY, v);
+        else if ((v = FlagValue(a, "track")))      state.Set(F_TRACK, v);
+        else if ((v = FlagValue(a, "artist")))     state.Set(F_ARTIST, v);
+        else return Usage(argv[0]);
+    }
+    if (width <= 0 || height <= 0 || frames < 0 || threads < 1 || fps < 1 || fps > 1000) return Usage(argv[0]);
+    const int64_t frame_ns = 1000000000LL / fps;
+    if (stress_rounds > 0) return RunStateStress(stress_rounds);
+
+    rgb_matrix::Font font;
+    if (!font.LoadFont(font_path)) {
+        fprintf(stderr, "Font load failed: %s\n", font_path);
+        return 1;
+    }
+    if (bench_iterations > 0) return RunRenderBenchmarks(font, font_path, bench_iterations);
+
+    Layout layout;
+    std::string layout_error;
+    const bool layout_ok = layout_path ? LoadLayout(layout_path, width, height, layout, layout_error)
+                                       : ParseLayout(DEFAULT_LAYOUT, width, height, layout, layout_error);
+    if (!layout_ok) {
+        fprintf(stderr, "Layout: %s\n", layout_error.c_str());
+        return 1;
+    }
+
+    FILE *out = nullptr;
+    if (dump_path) {
+        out = strcmp(dump_path, "-") == 0 ? stdout : fopen(dump_path, "wb");
+        if (!out) {
+            fprintf(stderr, "Can't open %s\n", dump_path);
+            return 1;
+        }
+    }
+
+    // Two buffers swapped every frame, like FrameCanvas + SwapOnVSync, so damage tracking
+    // behaves exactly as on the panel
+    SoftwareCanvas buffers[2] = { SoftwareCanvas(width, height), SoftwareCanvas(width, height) };
+    int front = 0;
+    DisplayRenderer renderer(font, width, height, std::move(layout));
+    renderer.SetFramePeriod(frame_ns);
+    RenderPool pool(threads);
+    renderer.SetTiling(&pool, tile_width);
+    StateData snapshot;
+
+    int drawn = 0;
+    long long damaged_px = 0;
+    const int64_t wall0 = ClockNs(CLOCK_MONOTONIC);
+    const int64_t cpu0  = ClockNs(CLOCK_PROCESS_CPUTIME_ID);
+
+    // Same steps as the main loop, minus the waiting: every iteration is a frame tick
+    for (int f = 0; f < frames; ++f) {
+        state.Snapshot(snapshot);
+        renderer.Tick(f * frame_ns); // simulated clock, so runs are repeatable
+        if (renderer.Update(snapshot)) {
+            renderer.Draw(&buffers[1 - front]);
+            front = 1 - front;
+            ++drawn;
+            damaged_px += renderer.damage().Area();
+        }
+        if (out) WriteFrame(out, buffers[front], ppm);
+    }
+
+    const int64_t wall = ClockNs(CLOCK_MONOTONIC) - wall0;
+    const int64_t cpu  = ClockNs(CLOCK_PROCESS_CPUTIME_ID) - cpu0;
+    if (out && out != stdout) fclose(out);
+
+    fprintf(stderr,
+            "%dx%d: %d frames (%d drawn) in %.1f ms, %.0f frames/s, %.0f ns CPU/frame, "
+            "%.1f%% of the panel damaged per drawn frame%s\n",
+            width, height, frames, drawn, wall / 1e6,
+            wall > 0 ? frames * 1e9 / wall : 0.0,
+            frames > 0 ? (double)cpu / frames : 0.0,
+            drawn > 0 ? 100.0 * damaged_px / ((double)drawn * width * height) : 0.0,
+            out ? " (including dump)" : "");
+    return 0;
+}
@@ -1,13 +1,16 @@
 #include "icons_weather.h"
-#include <unordered_map>
-#include <algorithm>
+#include "damage.h"
+#include "software_canvas.h"
+#include "color_lut.h"
+#include <array>
 #include <cstring>
 
 
 // Encoded icons:
 // To avoid a huge static byte dump, we encode each 16x16 icon as 16 strings,
 // each 16 chars wide. Each character maps to an entry in a palette of 24-bit
-// RGB colors. On InitIcons(), we expand into Icon16 pixel buffers.
+// RGB colors. The expansion into Icon16 pixel buffers happens at compile time,
+// so the decoded icons sit in one contiguous read-only atlas and startup does no work.
 //
 // This keeps the source human-readable and allows easy editing of icons.
 
@@ -15,32 +18,34 @@ namespace {
 
 struct RGB { uint8_t r,g,b; };
 struct EncodedIcon {
-    const char *name;
-    const char **rows; // 2d array, 16 strings of length 16
+    const char *const *rows; // 2d array, 16 strings of length 16 (shorter rows are padded with background)
     const RGB *palette;
     const char *legend; // characters in same order as palette entries
 };
 
-// Reusable colors (choose dim-ish values to avoid overpowering display at low gamma)
-// Some of the G and B values are swapped to match my Waveshare panel's hardware mapping, though not all.
+// Reusable colors, authored at full range: every hue at full intensity on its strongest
+// channel, so icons match text drawn in the same colors. The greys are shading tones against
+// white (cloud edges), not dimmed copies of it. Toning the panel down is left to the
+// renderer's ColorLut (--gamma, --white-balance, brightness), not baked into the palette.
+// All true RGB. Panels with swapped G/B are handled once by the matrix's --led-rgb-sequence option.
 static constexpr RGB BLACK {0,0,0};
 static constexpr RGB WHITE {255,255,255};
-static constexpr RGB YELLOW {255,0,200};
+static constexpr RGB YELLOW {255,200,0};
 static constexpr RGB ORANGE {255,120,0};
 static constexpr RGB BLUE {0,120,255};
 static constexpr RGB LIGHTBL {120,180,255};
 static constexpr RGB GRAY {90,90,90};
 static constexpr RGB LGREY {140,140,140};
-static constexpr RGB GREEN {0,210,0};
-static constexpr RGB CYAN {0,200,200};
-static constexpr RGB PURPLE {180,0,180};
+static constexpr RGB GREEN {0,255,0};
+static constexpr RGB CYAN {0,255,255};
+static constexpr RGB PURPLE {255,0,255};
 
 
 // Legend maps characters -> palette entries
 // '.' becomes BLACK, 'O' becomes YELLOW (outer), ORANGE shading painted later.
 // "clear" (sun)"
-static const RGB PAL_CLEAR[] = { BLACK, YELLOW, ORANGE };
-static const char *SUN_ROWS[16] = {
+static constexpr RGB PAL_CLEAR[] = { BLACK, YELLOW, ORANGE };
+static constexpr const char *SUN_ROWS[16] = {
 "......OO......",
 ".....OOOO.....",
 ".....OOOO.....",
@@ -61,8 +66,8 @@ static const char *SUN_ROWS[16] = {
 
 
 // "cloudy" (cloud)
-static const RGB PAL_CLOUD[] = { BLACK, LGREY, WHITE };
-static const char *CLOUD_ROWS[16] = {
+static constexpr RGB PAL_CLOUD[] = { BLACK, LGREY, WHITE };
+static constexpr const char *CLOUD_ROWS[16] = {
 "................",
 "................",
 ".....11.........",
@@ -82,8 +87,8 @@ static const char *CLOUD_ROWS[16] = {
 };
 
 // "rain" (cloud + drops)
-static const RGB PAL_RAIN[] = { BLACK, LGREY, WHITE, BLUE };
-static const char *RAIN_ROWS[16] = {
+static constexpr RGB PAL_RAIN[] = { BLACK, LGREY, WHITE, BLUE };
+static constexpr const char *RAIN_ROWS[16] = {
 "................",
 "................",
 ".....11.........",
@@ -103,8 +108,8 @@ static const char *RAIN_ROWS[16] = {
 };
 
 // "snow" (cloud + snowflakes)
-static const RGB PAL_SNOW[] = { BLACK, LGREY, WHITE, CYAN };
-static const char *SNOW_ROWS[16] = {
+static constexpr RGB PAL_SNOW[] = { BLACK, LGREY, WHITE, CYAN };
+static constexpr const char *SNOW_ROWS[16] = {
 "................",
 "................",
 ".....11.........",
@@ -124,8 +129,8 @@ static const char *SNOW_ROWS[16] = {
 };
 
 // "thunder" (cloud + thunderbolt)
-static const RGB PAL_THUNDER[] = { BLACK, LGREY, WHITE, YELLOW, ORANGE };
-static const char *THUNDER_ROWS[16] = {
+static constexpr RGB PAL_THUNDER[] = { BLACK, LGREY, WHITE, YELLOW, ORANGE };
+static constexpr const char *THUNDER_ROWS[16] = {
 "................",
 "................",
 ".....11.........",
@@ -145,8 +150,8 @@ static const char *THUNDER_ROWS[16] = {
 }; 
 
 // "unknown" (question mark)
-static const RGB PAL_UNKNOWN[] = { BLACK, PURPLE, WHITE };
-static const char *UNKNOWN_ROWS[16] = {
+static constexpr RGB PAL_UNKNOWN[] = { BLACK, PURPLE, WHITE };
+static constexpr const char *UNKNOWN_ROWS[16] = {
 "................",
 "..11111.........",
 ".11...11........",
@@ -166,8 +171,8 @@ static const char *UNKNOWN_ROWS[16] = {
 };
 
 // "play" icon, left over from testing
-static const RGB PAL_PLAY[] = { BLACK, GREEN };
-static const char *PLAY_ROWS[16] = {
+static constexpr RGB PAL_PLAY[] = { BLACK, GREEN };
+static constexpr const char *PLAY_ROWS[16] = {
 "................",
 "................",
 "...1............",
@@ -187,8 +192,8 @@ static const char *PLAY_ROWS[16] = {
 };
 
 // "pause" icon, left over from testing
-static const RGB PAL_PAUSE[] = { BLACK, CYAN };
-static const char *PAUSE_ROWS[16] = {
+static constexpr RGB PAL_PAUSE[] = { BLACK, CYAN };
+static constexpr const char *PAUSE_ROWS[16] = {
 "................",
 "................",
 "..11....11......",
@@ -207,26 +212,35 @@ static const char *PAUSE_ROWS[16] = {
 "................"
 };
 
-static EncodedIcon ENCODED[] = {
-    { "clear", SUN_ROWS, PAL_CLEAR, ".O" },
-    { "sunny", SUN_ROWS, PAL_CLEAR, ".O" },  // alias
-    { "cloudy", CLOUD_ROWS, PAL_CLOUD, ".12" },
-    { "rain", RAIN_ROWS, PAL_RAIN, ".12 3" }, // technically unsafe to use a space to skip when mapping icons to colors
-    { "snow", SNOW_ROWS, PAL_SNOW, ".12 3" },
-    { "thunder", THUNDER_ROWS, PAL_THUNDER, ".12 4" },
-    { "unknown", UNKNOWN_ROWS, PAL_UNKNOWN, ".1" },
-    { "play", PLAY_ROWS, PAL_PLAY, ".1" },
-    { "pause", PAUSE_ROWS, PAL_PAUSE, ".1" },
+// Indexed by IconId
+static constexpr EncodedIcon ENCODED[ICON_COUNT] = {
+    { SUN_ROWS, PAL_CLEAR, ".O" },         // ICON_CLEAR
+    { CLOUD_ROWS, PAL_CLOUD, ".12" },      // ICON_CLOUDY
+    { RAIN_ROWS, PAL_RAIN, ".123" },       // ICON_RAIN
+    { SNOW_ROWS, PAL_SNOW, ".123" },       // ICON_SNOW
+    { THUNDER_ROWS, PAL_THUNDER, ".1234" }, // ICON_THUNDER, '3' (yellow) unused
+    { UNKNOWN_ROWS, PAL_UNKNOWN, ".1" },   // ICON_UNKNOWN
+    { PLAY_ROWS, PAL_PLAY, ".1" },         // ICON_PLAY
+    { PAUSE_ROWS, PAL_PAUSE, ".1" },       // ICON_PAUSE
 };
 
-// Storing decoded pixel buffers
-// TODO: make guarded
-static std::unordered_map<std::string, Icon16> gIcons;
-static bool gInitialized = false;
+// Names accepted by GetIconByName, aliases just point at the same atlas entry
+struct IconName { const char *name; IconId id; };
+static constexpr IconName ICON_NAMES[] = {
+    { "clear", ICON_CLEAR },
+    { "sunny", ICON_CLEAR }, // alias
+    { "cloudy", ICON_CLOUDY },
+    { "rain", ICON_RAIN },
+    { "snow", ICON_SNOW },
+    { "thunder", ICON_THUNDER },
+    { "unknown", ICON_UNKNOWN },
+    { "play", ICON_PLAY },
+    { "pause", ICON_PAUSE },
+};
 
 // Map character to RGB color using icon's palette legend.
 // If symbol not found, returns same as '.' (background color).
-static RGB LookupColor(char c, const RGB *palette, const char *legend) {
+constexpr RGB LookupColor(char c, const RGB *palette, const char *legend) {
     if (c == '.') return palette[0]; // fast path for background, minimal resource usage
     const char *p = legend;
     int idx = 0;
@@ -239,127 +253,404 @@ static RGB LookupColor(char c, const RGB *palette, const char *legend) {
 
 // post-processing (shading) for specific icons
 // Only adjusts g channel, should probably be expanded to work across whole rgb space
-static void PostProcess(const std::string &name, Icon16 &icon) {
-    if (name == "clear" || name == "sunny") {
+constexpr void PostProcess(IconId id, Icon16 &icon) {
+    if (id == ICON_CLEAR) {
         // Add orange rim to differentiate the two by modifying outer ring pixels, detects yellow near boundary
         for (int y=0; y<16; ++y) {
             for (int x=0; x<16; ++x) {
                 int idx = (y*16 + x)*3;
                 uint8_t &r = icon.pixels[idx], &g = icon.pixels[idx+1], &b = icon.pixels[idx+2];
                 if (r > 200 && g > 150 && b < 50) {
-                    // If near edge ( measuring distance from center > ~5.5) we tint orange
-                    float dx = x - 7.5f;
-                    float dy = y - 7.5f;
-                    float dist = dx*dx + dy*dy;
-                    if (dist > 30.f) { // outer region
-                        g = (uint8_t)(g * 0.6f);
+                    // If near edge (distance from center > ~5.5) we tint orange. Doubled
+                    // coordinates keep the center at (15, 15) in integers.
+                    const int dx = 2*x - 15, dy = 2*y - 15;
+                    if (dx*dx + dy*dy > 120) { // outer region
+                        g = (uint8_t)(g * 3 / 5);
                     }
                 }
             }
         }
-    } else if (name == "thunder") {
+    } else if (id == ICON_THUNDER) {
         // slight bit of orange at the bottom of the bolt by checking for any yellow pixel with y > 9
         for (int y=10; y<16; ++y) {
             for (int x=0; x<16; ++x) {
                 int idx = (y*16 + x)*3;
                 uint8_t &r = icon.pixels[idx], &g = icon.pixels[idx+1], &b = icon.pixels[idx+2];
                 if (r > 200 && g > 150 && b < 40) {
-                    g = (uint8_t)(g * 0.7f);
+                    g = (uint8_t)(g * 7 / 10);
                 }
             }
         }
     }
 }
 
+constexpr Icon16 Decode(const EncodedIcon &e, IconId id) {
+    Icon16 icon{};
+    int outIdx = 0;
+    for (int row=0; row<16; ++row) {
+        const char *line = e.rows[row];
+        bool ended = false; // rows shorter than 16 are padded with background
+        for (int col=0; col<16; ++col) {
+            if (!ended && line[col] == '\0') ended = true;
+            char sym = ended ? '.' : line[col];
+            RGB color = LookupColor(sym, e.palette, e.legend);
+            icon.pixels[outIdx++] = color.r;
+            icon.pixels[outIdx++] = color.g;
+            icon.pixels[outIdx++] = color.b;
+        }
+    }
+    PostProcess(id, icon);
+    return icon;
+}
+
+// Animation. Frame 0 of every icon is the drawn art above; the weather icons get extra frames
+// generated from it: drops fall through the rows under the cloud, flakes fall and sway, and
+// the bolt flashes. Each frame has its own duration.
+constexpr int PRECIP_TOP = 10; // first row under the cloud
+constexpr int PRECIP_ROWS = 6; // rows 10..15, drops wrap around within them
+
+constexpr int FrameCountOf(IconId id) {
+    return id == ICON_RAIN ? 6 : id == ICON_SNOW ? 6 : id == ICON_THUNDER ? 4 : 1;
+}
+
+// Milliseconds each frame stays up, 0 for static icons
+constexpr uint16_t FrameMs(IconId id, int k) {
+    constexpr uint16_t THUNDER_MS[4] = { 1200, 70, 120, 70 }; // bolt, flash, dark, flash
+    return id == ICON_RAIN ? 120 : id == ICON_SNOW ? 260 : id == ICON_THUNDER ? THUNDER_MS[k] : 0;
+}
+
+constexpr int TotalFrames() {
+    int n = 0;
+    for (int i = 0; i < ICON_COUNT; ++i) n += FrameCountOf((IconId)i);
+    return n;
+}
+constexpr int TOTAL_FRAMES = TotalFrames();
+
+struct FrameRange { uint16_t first, count; uint32_t cycle_ms; };
+
+constexpr std::array<FrameRange, ICON_COUNT> BuildRanges() {
+    std::array<FrameRange, ICON_COUNT> ranges{};
+    int first = 0;
+    for (int i = 0; i < ICON_COUNT; ++i) {
+        const int count = FrameCountOf((IconId)i);
+        uint32_t cycle = 0;
+        for (int k = 0; k < count; ++k) cycle += FrameMs((IconId)i, k);
+        ranges[i] = { (uint16_t)first, (uint16_t)count, cycle };
+        first += count;
+    }
+    return ranges;
+}
+
+constexpr void CopyPixel(const Icon16 &src, int sx, int sy, Icon16 &dst, int dx, int dy) {
+    for (int c = 0; c < 3; ++c) dst.pixels[(dy * 16 + dx) * 3 + c] = src.pixels[(sy * 16 + sx) * 3 + c];
+}
+
+constexpr bool Lit(const Icon16 &icon, int x, int y) {
+    const int i = (y * 16 + x) * 3;
+    return icon.pixels[i] | icon.pixels[i + 1] | icon.pixels[i + 2];
+}
+
+// Frame k of an animated icon, built from its base art
+constexpr Icon16 AnimateFrame(IconId id, const Icon16 &base, int k) {
+    if (k == 0) return base;
+    Icon16 out = base;
+    for (int y = PRECIP_TOP; y < 16; ++y)
+        for (int x = 0; x < 16; ++x)
+            for (int c = 0; c < 3; ++c) out.pixels[(y * 16 + x) * 3 + c] = 0;
+
+    if (id == ICON_THUNDER) {
+        // Odd frames flash the bolt white, frame 2 is dark in between
+        if (k == 2) return out;
+        for (int y = PRECIP_TOP; y < 16; ++y)
+            for (int x = 0; x < 16; ++x)
+                if (Lit(base, x, y))
+                    for (int c = 0; c < 3; ++c) out.pixels[(y * 16 + x) * 3 + c] = 255;
+        return out;
+    }
+
+    // Rain falls a row per frame; snow does too, swaying a pixel right every other pair of frames
+    const int sway = (id == ICON_SNOW) ? (k / 2) % 2 : 0;
+    for (int y = PRECIP_TOP; y < 16; ++y) {
+        for (int x = 0; x < 16; ++x) {
+            if (!Lit(base, x, y)) continue;
+            const int ny = PRECIP_TOP + (y - PRECIP_TOP + k) % PRECIP_ROWS;
+            const int nx = (x + sway < 16) ? x + sway : x;
+            CopyPixel(base, x, y, out, nx, ny);
+        }
+    }
+    return out;
+}
+
+constexpr std::array<FrameRange, ICON_COUNT> RANGES = BuildRanges();
+
+// Every frame of every icon in one contiguous array, an icon's frames back to back
+constexpr std::array<Icon16, TOTAL_FRAMES> BuildAtlas() {
+    std::array<Icon16, TOTAL_FRAMES> atlas{};
+    for (int i = 0; i < ICON_COUNT; ++i) {
+        const Icon16 base = Decode(ENCODED[i], (IconId)i);
+        for (int k = 0; k < RANGES[i].count; ++k) atlas[RANGES[i].first + k] = AnimateFrame((IconId)i, base, k);
+    }
+    return atlas;
+}
+
+constexpr std::array<uint16_t, TOTAL_FRAMES> BuildFrameMs() {
+    std::array<uint16_t, TOTAL_FRAMES> ms{};
+    for (int i = 0; i < ICON_COUNT; ++i)
+        for (int k = 0; k < RANGES[i].count; ++k) ms[RANGES[i].first + k] = FrameMs((IconId)i, k);
+    return ms;
+}
+
+// Decoded pixel buffers and frame timing, built by the compiler and stored read-only
+static constexpr std::array<Icon16, TOTAL_FRAMES> ATLAS = BuildAtlas();
+static constexpr std::array<uint16_t, TOTAL_FRAMES> FRAME_MS = BuildFrameMs();
+
 } 
 
 // declaring namespace
 
-bool InitIcons() {
-    if (gInitialized) return true;
-
-    for (const auto &e : ENCODED) {
-        Icon16 icon{};
-        int outIdx = 0;
-        for (int row=0; row<16; ++row) {
-            const char *line = e.rows[row];
-            for (int col=0; col<16; ++col) {
-                char sym = line[col];
-                RGB color = LookupColor(sym, e.palette, e.legend);
-                icon.pixels[outIdx++] = color.r;
-                icon.pixels[outIdx++] = color.g;
-                icon.pixels[outIdx++] = color.b;
-            }
+const Icon16* GetIcon(IconId id) {
+    return GetIconFrame(id, 0);
+}
+
+int IconFrameCount(IconId id) {
+    return RANGES[id < ICON_COUNT ? id : ICON_UNKNOWN].count;
+}
+
+const Icon16* GetIconFrame(IconId id, int frame) {
+    const FrameRange &r = RANGES[id < ICON_COUNT ? id : ICON_UNKNOWN];
+    return &ATLAS[r.first + ((frame >= 0 && frame < r.count) ? frame : 0)];
+}
+
+int IconFrameAt(IconId id, int64_t elapsed_ns, int64_t *until_next_ns) {
+    const FrameRange &r = RANGES[id < ICON_COUNT ? id : ICON_UNKNOWN];
+    if (r.count <= 1 || r.cycle_ms == 0) {
+        if (until_next_ns) *until_next_ns = -1;
+        return 0;
+    }
+    int64_t t = (elapsed_ns > 0 ? elapsed_ns : 0) % ((int64_t)r.cycle_ms * 1000000);
+    for (int k = 0; k < r.count; ++k) {
+        const int64_t d = (int64_t)FRAME_MS[r.first + k] * 1000000;
+        if (t < d) {
+            if (until_next_ns) *until_next_ns = d - t;
+            return k;
         }
-        PostProcess(e.name, icon);
-        gIcons.emplace(e.name, icon);
+        t -= d;
     }
+    if (until_next_ns) *until_next_ns = -1; // not reached, t < cycle
+    return 0;
+}
 
-    // Provide mapping to existing icon buffers
-    // todo: add actual aliasing support rather than just copying
-    if (gIcons.find("clear") != gIcons.end() && gIcons.find("sunny") == gIcons.end()) {
-        gIcons["sunny"] = gIcons["clear"];
+const Icon16* GetIconByName(const std::string &name) {
+    for (const auto &n : ICON_NAMES) {
+        if (name == n.name) return GetIcon(n.id);
     }
-    if (gIcons.find("unknown") == gIcons.end()) {
-        // guarantee unknown exists
-        gIcons["unknown"] = Icon16{};
+    return nullptr;
+}
+
+namespace {
+
+// Calls put(x, y, rgb) for each pixel of the icon at (x, y) inside r, skipping black ones
+// when keyed. Instantiated per pixel writer, so nothing in the inner loop depends on the mode.
+template <bool KEYED, typename Put>
+inline void BlitSpans(const Icon16 *icon, int x, int y, const Rect &r, Put put) {
+    for (int yy = r.y0; yy < r.y1; ++yy) {
+        const uint8_t *src = &icon->pixels[((yy - y)*16 + (r.x0 - x))*3];
+        for (int xx = r.x0; xx < r.x1; ++xx, src += 3) {
+            if (KEYED && !(src[0] | src[1] | src[2])) continue;
+            put(xx, yy, src);
+        }
     }
+}
 
-    gInitialized = true;
-    return true;
+template <typename Put>
+inline void BlitSpans(const Icon16 *icon, int x, int y, const Rect &r, bool keyed, Put put) {
+    if (keyed) BlitSpans<true>(icon, x, y, r, put);
+    else BlitSpans<false>(icon, x, y, r, put);
 }
 
-const Icon16* GetIconByName(const std::string &name) {
-    auto it = gIcons.find(name);
-    if (it != gIcons.end()) return &it->second;
-    return nullptr;
 }
 
-static void BlitIcon(const Icon16 *icon, rgb_matrix::Canvas *canvas, int x, int y) {
+void BlitIcon(const Icon16 *icon, rgb_matrix::Canvas *canvas, int x, int y, BlitMode mode,
+              const ColorLut *lut) {
     if (!icon) return;
-    for (int j=0; j<16; ++j) {
-        int yy = y + j;
-        if (yy < 0 || yy >= canvas->height()) continue;
-        for (int i=0; i<16; ++i) {
-            int xx = x + i;
-            if (xx < 0 || xx >= canvas->width()) continue;
-            int idx = (j*16 + i)*3;
-            canvas->SetPixel(xx, yy,
-                             icon->pixels[idx],
-                             icon->pixels[idx+1],
-                             icon->pixels[idx+2]);
+
+    // Work out the visible part of the icon once, instead of bounds checking every pixel.
+    // A ClipCanvas (damage repaint) is unwrapped so its clip folds into the same rectangle.
+    Rect clip = MakeRect(0, 0, canvas->width(), canvas->height());
+    if (auto *cc = dynamic_cast<ClipCanvas*>(canvas)) {
+        clip = cc->clip();
+        canvas = cc->inner();
+    }
+    const Rect r = Intersect(clip, MakeRect(x, y, 16, 16));
+    if (r.Empty()) return;
+    const int spanW = r.x1 - r.x0;
+    const bool keyed = (mode == BLIT_TRANSPARENT);
+    const int shift = (mode == BLIT_DIM) ? 1 : 0;
+    if (lut && lut->identity()) lut = nullptr;
+
+    // Fast path: packed software framebuffer, copy whole row spans
+    if (auto *sw = dynamic_cast<SoftwareCanvas*>(canvas)) {
+        for (int yy = r.y0; yy < r.y1; ++yy) {
+            const uint8_t *src = &icon->pixels[((yy - y)*16 + (r.x0 - x))*3];
+            uint8_t *dst = sw->Row(yy) + r.x0*3;
+            if (mode == BLIT_OPAQUE && !lut) {
+                memcpy(dst, src, spanW*3);
+                continue;
+            }
+            for (int i = 0; i < spanW; ++i, src += 3, dst += 3) {
+                if (keyed && !(src[0] | src[1] | src[2])) continue;
+                if (lut) {
+                    dst[0] = lut->r(src[0] >> shift); dst[1] = lut->g(src[1] >> shift); dst[2] = lut->b(src[2] >> shift);
+                } else {
+                    dst[0] = src[0] >> shift; dst[1] = src[1] >> shift; dst[2] = src[2] >> shift;
+                }
+            }
         }
+        return;
+    }
+
+    // Generic canvas (FrameCanvas): one SetPixel per pixel is all it offers, so the inner
+    // loop is kept as tight as the old unclipped one, with the mode and color table picked
+    // once per blit rather than tested for every pixel
+    if (lut) {
+        BlitSpans(icon, x, y, r, keyed, [&](int xx, int yy, const uint8_t *s) {
+            canvas->SetPixel(xx, yy, lut->r(s[0] >> shift), lut->g(s[1] >> shift), lut->b(s[2] >> shift));
+        });
+    } else if (shift) {
+        BlitSpans(icon, x, y, r, keyed, [&](int xx, int yy, const uint8_t *s) {
+            canvas->SetPixel(xx, yy, s[0] >> 1, s[1] >> 1, s[2] >> 1);
+        });
+    } else {
+        BlitSpans(icon, x, y, r, keyed, [&](int xx, int yy, const uint8_t *s) {
+            canvas->SetPixel(xx, yy, s[0], s[1], s[2]);
+        });
     }
 }
 
-void DrawWeatherIcon(const std::string &condition,
-                     rgb_matrix::Canvas *canvas,
-                     int x, int y) {
-    if (!gInitialized) InitIcons();
+// Condition -> icon resolver
+// Home Assistant condition names (plus a few aliases other integrations send) go into a
+// perfect hash table built at compile time: every name lands in its own slot, so a lookup
+// is one hash over the payload, one slot read and one string compare. Nothing is allocated,
+// and adding an alias is one line in the table rather than another branch.
+
+namespace {
+
+struct ConditionName { const char *name; IconId id; };
+static constexpr ConditionName CONDITIONS[] = {
+    // Home Assistant weather conditions
+    { "clear-night", ICON_CLEAR },
+    { "cloudy", ICON_CLOUDY },
+    { "exceptional", ICON_UNKNOWN },
+    { "fog", ICON_CLOUDY },
+    { "hail", ICON_SNOW },
+    { "lightning", ICON_THUNDER },
+    { "lightning-rainy", ICON_THUNDER },
+    { "partlycloudy", ICON_CLOUDY }, // (create a separate partly icon later)
+    { "pouring", ICON_RAIN },
+    { "rainy", ICON_RAIN },
+    { "snowy", ICON_SNOW },
+    { "snowy-rainy", ICON_SNOW },
+    { "sunny", ICON_CLEAR },
+    { "windy", ICON_CLOUDY },
+    { "windy-variant", ICON_CLOUDY },
+    // Aliases and our own icon names
+    { "clear", ICON_CLEAR },
+    { "partly-cloudy", ICON_CLOUDY },
+    { "partly-cloudy-day", ICON_CLOUDY },
+    { "partlycloudy-day", ICON_CLOUDY },
+    { "thunderstorm", ICON_THUNDER },
+    { "thunder", ICON_THUNDER },
+    { "showers", ICON_RAIN },
+    { "rain", ICON_RAIN },
+    { "snow", ICON_SNOW },
+    { "unknown", ICON_UNKNOWN },
+};
+static constexpr int NUM_CONDITIONS = sizeof(CONDITIONS) / sizeof(CONDITIONS[0]);
+static constexpr int COND_SLOT_BITS = 6;
+static constexpr int COND_SLOTS = 1 << COND_SLOT_BITS; // well above NUM_CONDITIONS
+static constexpr int MAX_COND_LEN = 32; // longer payloads can't match anything
+
+constexpr char LowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+// FNV-1a over the lowercased name, seeded so we can search for a collision-free seed
+constexpr uint32_t CondHash(uint32_t seed, const char *s, size_t len) {
+    uint32_t h = 2166136261u ^ seed;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= (uint8_t)LowerAscii(s[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Slot from the top bits, the low bits of an FNV product barely depend on the seed
+constexpr uint32_t CondSlot(uint32_t h) {
+    return h >> (32 - COND_SLOT_BITS);
+}
+
+constexpr size_t ConstLen(const char *s) {
+    size_t n = 0;
+    while (s[n]) ++n;
+    return n;
+}
+
+constexpr bool SeedIsPerfect(uint32_t seed) {
+    bool used[COND_SLOTS] = {};
+    for (int i = 0; i < NUM_CONDITIONS; ++i) {
+        const uint32_t slot = CondSlot(CondHash(seed, CONDITIONS[i].name, ConstLen(CONDITIONS[i].name)));
+        if (used[slot]) return false;
+        used[slot] = true;
+    }
+    return true;
+}
+
+constexpr uint32_t FindSeed() {
+    for (uint32_t seed = 0; seed < 4096; ++seed) {
+        if (SeedIsPerfect(seed)) return seed;
+    }
+    return 0xFFFFFFFFu;
+}
+
+static constexpr uint32_t COND_SEED = FindSeed();
+static_assert(COND_SEED != 0xFFFFFFFFu, "no collision-free seed, grow COND_SLOTS");
 
-    // Normalize condition to a small set.
-    std::string key = condition;
-    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+// Slot -> index into CONDITIONS, -1 for empty
+constexpr std::array<int8_t, COND_SLOTS> BuildCondTable() {
+    std::array<int8_t, COND_SLOTS> table{};
+    for (auto &t : table) t = -1;
+    for (int i = 0; i < NUM_CONDITIONS; ++i) {
+        table[CondSlot(CondHash(COND_SEED, CONDITIONS[i].name, ConstLen(CONDITIONS[i].name)))] = (int8_t)i;
+    }
+    return table;
+}
+static constexpr std::array<int8_t, COND_SLOTS> COND_TABLE = BuildCondTable();
 
-    // Mapping Home Assistant names
-    if (key == "clear-night") key = "clear";
-    else if (key == "partlycloudy" || key == "partly-cloudy" || key == "partly-cloudy-day" ||
-             key == "partlycloudy-day") key = "cloudy"; // (create a separate partly icon later)
-    else if (key == "lightning" || key == "lightning-rainy" || key == "thunderstorm") key = "thunder";
-    else if (key == "rainy" || key == "pouring" || key == "showers") key = "rain";
-    else if (key == "snowy" || key == "snowy-rainy" || key == "hail" || key == "snow") key = "snow";
+}
 
-    const Icon16 *icon = GetIconByName(key);
-    if (!icon) icon = GetIconByName("unknown");
-    BlitIcon(icon, canvas, x, y);
+IconId ResolveWeatherIcon(const char *condition, size_t len) {
+    if (len == 0 || len > MAX_COND_LEN) return ICON_UNKNOWN;
+    const int idx = COND_TABLE[CondSlot(CondHash(COND_SEED, condition, len))];
+    if (idx < 0) return ICON_UNKNOWN;
+
+    // The slot is only a candidate, confirm it's really this name (case-insensitive)
+    const char *name = CONDITIONS[idx].name;
+    for (size_t i = 0; i < len; ++i) {
+        if (name[i] == '\0' || name[i] != LowerAscii(condition[i])) return ICON_UNKNOWN;
+    }
+    return (name[len] == '\0') ? CONDITIONS[idx].id : ICON_UNKNOWN;
+}
+
+void DrawWeatherIcon(IconId icon,
+                     rgb_matrix::Canvas *canvas,
+                     int x, int y, BlitMode mode) {
+    BlitIcon(GetIcon(icon), canvas, x, y, mode);
 }
 
 // Generic icons reuse same storage (play, pause)
 void DrawPlayIcon(rgb_matrix::Canvas *canvas, int x, int y) {
-    if (!gInitialized) InitIcons();
-    BlitIcon(GetIconByName("play"), canvas, x, y);
+    BlitIcon(GetIcon(ICON_PLAY), canvas, x, y);
 }
 void DrawPauseIcon(rgb_matrix::Canvas *canvas, int x, int y) {
-    if (!gInitialized) InitIcons();
-    BlitIcon(GetIconByName("pause"), canvas, x, y);
+    BlitIcon(GetIcon(ICON_PAUSE), canvas, x, y);
 }
@@ -4,19 +4,55 @@
 #include <vector>
 #include "canvas.h"
 
+class ColorLut;
+
 // Each icon is 16x16 RGB (24 bit) stored tightly: size = 16*16*3 = 768 bytes
 struct Icon16 {
     uint8_t pixels[16 * 16 * 3];
 };
 
-// Call once at startup. Returns true on success.
-bool InitIcons();
+// Icons in the compile-time atlas. IDs index the atlas directly, no lookup needed.
+enum IconId : uint8_t {
+    ICON_CLEAR,
+    ICON_CLOUDY,
+    ICON_RAIN,
+    ICON_SNOW,
+    ICON_THUNDER,
+    ICON_UNKNOWN,
+    ICON_PLAY,
+    ICON_PAUSE,
+    ICON_COUNT
+};
+
+// Decoded icon for an ID, out of range IDs give the "unknown" icon
+const Icon16* GetIcon(IconId id);
+
+// Animated icons (rain, snow, thunder) have several frames, each shown for its own time,
+// stored back to back in the same read-only atlas. Frame 0 is the static icon.
+int IconFrameCount(IconId id);
+const Icon16* GetIconFrame(IconId id, int frame);
 
-// Draw a weather condition icon (falls back to "unknown")
-// (x,y) is top-left on the target canvas. Safe if partially off-screen (clipped manually)
-void DrawWeatherIcon(const std::string &condition,
+// Frame to show elapsed_ns after the icon appeared, looping. until_next_ns gets the time
+// left until the frame changes, or -1 for a static icon.
+int IconFrameAt(IconId id, int64_t elapsed_ns, int64_t *until_next_ns);
+
+// Map a Home Assistant weather condition ("partlycloudy", "windy-variant", "fog"...) to an icon.
+// Case-insensitive, allocation-free. Unrecognised conditions give ICON_UNKNOWN.
+// Meant to be called once when the MQTT message arrives, not per frame.
+IconId ResolveWeatherIcon(const char *condition, size_t len);
+inline IconId ResolveWeatherIcon(const std::string &condition) {
+    return ResolveWeatherIcon(condition.data(), condition.size());
+}
+
+// How icon pixels are written. Transparent skips black (the icon background) so icons
+// can be drawn over something else. Dim is opaque at half intensity, for stale content.
+enum BlitMode { BLIT_OPAQUE, BLIT_TRANSPARENT, BLIT_DIM };
+
+// Draw a weather icon resolved by ResolveWeatherIcon
+// (x,y) is top-left on the target canvas. Safe if partially off-screen (clipped once per blit)
+void DrawWeatherIcon(IconId icon,
                      rgb_matrix::Canvas *canvas,
-                     int x, int y);
+                     int x, int y, BlitMode mode = BLIT_OPAQUE);
 
 // Generic testing icons
 void DrawPlayIcon(rgb_matrix::Canvas *canvas, int x, int y);
@@ -25,3 +61,9 @@ void DrawPauseIcon(rgb_matrix::Canvas *canvas, int x, int y);
 // if you want custom composition with an actual icon, retrieve the raw icon pointer 
 // returns nullptr if name unknown.
 const Icon16* GetIconByName(const std::string &name);
+
+// Copy an icon to the canvas at (x,y), clipped to the canvas (or to a ClipCanvas's region).
+// Writes packed rows directly when the target is a SoftwareCanvas. Pixels go through lut
+// (color_lut.h) when one is given.
+void BlitIcon(const Icon16 *icon, rgb_matrix::Canvas *canvas, int x, int y,
+              BlitMode mode = BLIT_OPAQUE, const ColorLut *lut = nullptr);
@@ -0,0 +1,215 @@
+#include "layout.h"
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+const char *DEFAULT_LAYOUT =
+    "icon     field=cond    x=0  y=0\n"
+    "text     field=temp    x=18 y=10   color=ffff00 suffix=C\n"
+    "text     field=summary x=0  y=22   color=00ffff chars=20\n"
+    "scroller field=track   x=0  y=H-12 color=ffffff\n"
+    "scroller field=artist  x=0  y=H-1  color=00ff00\n";
+
+namespace {
+
+struct Name { const char *name; int value; };
+
+const Name KINDS[] = {
+    { "icon", W_ICON }, { "text", W_TEXT }, { "scroller", W_SCROLLER }, { "bar", W_BAR },
+};
+
+const Name FIELDS[] = {
+    { "cond", F_WEATHER_COND }, { "temp", F_WEATHER_TEMP }, { "summary", F_WEATHER_SUMMARY },
+    { "track", F_TRACK }, { "artist", F_ARTIST }, { "brightness", F_BRIGHTNESS },
+};
+
+template <size_t N>
+bool FindName(const Name (&table)[N], const std::string &name, int &out) {
+    for (const Name &n : table) {
+        if (name == n.name) {
+            out = n.value;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Split a line into whitespace separated tokens. A double quoted part keeps its spaces,
+// so suffix=" C" is one token. Stops at an unquoted '#'.
+std::vector<std::string> Tokenize(const std::string &line) {
+    std::vector<std::string> tokens;
+    std::string cur;
+    bool quoted = false, any = false;
+    for (char c : line) {
+        if (c == '"') {
+            quoted = !quoted;
+            any = true;
+        } else if (!quoted && c == '#') {
+            break;
+        } else if (!quoted && (c == ' ' || c == '\t' || c == '\r')) {
+            if (any) tokens.push_back(cur);
+            cur.clear();
+            any = false;
+        } else {
+            cur += c;
+            any = true;
+        }
+    }
+    if (any) tokens.push_back(cur);
+    return tokens;
+}
+
+bool ParseInt(const std::string &s, int &out) {
+    if (s.empty()) return false;
+    char *end;
+    const long v = strtol(s.c_str(), &end, 10);
+    if (*end != '\0' || v < -100000 || v > 100000) return false;
+    out = (int)v;
+    return true;
+}
+
+// N, W, H, W-N, H+N
+bool ParseCoord(const std::string &s, int width, int height, int &out) {
+    if (s.empty()) return false;
+    int base = 0;
+    std::string rest = s;
+    if (s[0] == 'W' || s[0] == 'H') {
+        base = s[0] == 'W' ? width : height;
+        rest = s.substr(1);
+        if (rest.empty()) {
+            out = base;
+            return true;
+        }
+        if (rest[0] != '+' && rest[0] != '-') return false;
+    }
+    int offset;
+    if (!ParseInt(rest[0] == '+' ? rest.substr(1) : rest, offset)) return false;
+    out = base + offset;
+    return true;
+}
+
+bool ParseColor(const std::string &s, rgb_matrix::Color &out) {
+    if (s.size() != 6 || s.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) return false;
+    const unsigned long v = strtoul(s.c_str(), nullptr, 16);
+    out = rgb_matrix::Color((v >> 16) & 0xff, (v >> 8) & 0xff, v & 0xff);
+    return true;
+}
+
+// Finite numbers only: strtof takes "nan" and "inf", and a NaN passes every range check
+bool ParseFloat(const std::string &s, float &out) {
+    if (s.empty()) return false;
+    char *end;
+    out = strtof(s.c_str(), &end);
+    return *end == '\0' && std::isfinite(out);
+}
+
+// change, anim or a number of redraws per second
+bool ParseRate(const std::string &s, WidgetSpec &w) {
+    if (s == "change") {
+        w.refresh = REFRESH_CHANGE;
+        return true;
+    }
+    if (s == "anim") {
+        w.refresh = REFRESH_ANIMATED;
+        return true;
+    }
+    w.refresh = REFRESH_FIXED;
+    return ParseFloat(s, w.rate) && w.rate > 0 && w.rate <= 120;
+}
+
+}
+
+bool ParseLayout(const std::string &text, int width, int height, Layout &out, std::string &error) {
+    Layout layout;
+    std::istringstream in(text);
+    std::string line;
+    int lineNo = 0;
+
+    while (std::getline(in, line)) {
+        ++lineNo;
+        const std::vector<std::string> tokens = Tokenize(line);
+        if (tokens.empty()) continue;
+
+        auto fail = [&](const std::string &what) {
+            error = "line " + std::to_string(lineNo) + ": " + what;
+            return false;
+        };
+
+        int kind;
+        if (!FindName(KINDS, tokens[0], kind)) return fail("unknown widget '" + tokens[0] + "'");
+        WidgetSpec w;
+        w.kind = (WidgetKind)kind;
+        bool hasField = false, hasY = false, hasW = false, hasH = false, hasRate = false;
+
+        for (size_t i = 1; i < tokens.size(); ++i) {
+            const std::string &t = tokens[i];
+            const size_t eq = t.find('=');
+            if (eq == std::string::npos) return fail("expected key=value, got '" + t + "'");
+            const std::string key = t.substr(0, eq), value = t.substr(eq + 1);
+            bool ok = true;
+            int f = 0;
+            if (key == "field")       { ok = FindName(FIELDS, value, f); w.field = (StateField)f; hasField = ok; }
+            else if (key == "x")      ok = ParseCoord(value, width, height, w.x);
+            else if (key == "y")      { ok = ParseCoord(value, width, height, w.y); hasY = true; }
+            else if (key == "w")      { ok = ParseCoord(value, width, height, w.w); hasW = true; }
+            else if (key == "h")      { ok = ParseCoord(value, width, height, w.h); hasH = true; }
+            else if (key == "color")  ok = ParseColor(value, w.color);
+            else if (key == "prefix") w.prefix = value;
+            else if (key == "suffix") w.suffix = value;
+            else if (key == "chars")  ok = ParseInt(value, w.chars) && w.chars >= 0;
+            else if (key == "min")    ok = ParseFloat(value, w.min);
+            else if (key == "max")    ok = ParseFloat(value, w.max);
+            else if (key == "speed")  ok = ParseFloat(value, w.speed) && w.speed > 0 && w.speed <= 1000;
+            else if (key == "rate")   { ok = ParseRate(value, w); hasRate = true; }
+            else if (key == "font") {
+                auto font = std::make_unique<rgb_matrix::Font>();
+                if (!font->LoadFont(value.c_str())) return fail("can't load font " + value);
+                w.font = font.get();
+                layout.fonts.push_back(std::move(font));
+            }
+            else return fail("unknown option '" + key + "'");
+            if (!ok) return fail("bad value for " + key + ": '" + value + "'");
+        }
+
+        if (!hasField) return fail("missing field=");
+        if (!hasY) return fail("missing y=");
+        const bool moves = w.kind == W_ICON || w.kind == W_SCROLLER;
+        if (!hasRate) w.refresh = moves ? REFRESH_ANIMATED : REFRESH_CHANGE;
+        if (w.refresh == REFRESH_ANIMATED && !moves) return fail("rate=anim is only for icons and scrollers");
+        switch (w.kind) {
+        case W_ICON:
+            if (w.field != F_WEATHER_COND) return fail("icons can only show field=cond");
+            break;
+        case W_SCROLLER:
+            if (!hasW) w.w = width - w.x;
+            if (w.w <= 0) return fail("scroller has no width");
+            break;
+        case W_BAR:
+            if (!hasW || !hasH || w.w <= 0 || w.h <= 0) return fail("bars need w= and h=");
+            if (w.max <= w.min) return fail("bar max must be above min");
+            break;
+        case W_TEXT:
+            break;
+        }
+        layout.widgets.push_back(std::move(w));
+    }
+
+    out = std::move(layout);
+    return true;
+}
+
+bool LoadLayout(const char *path, int width, int height, Layout &out, std::string &error) {
+    std::ifstream f(path);
+    if (!f) {
+        error = std::string("can't open ") + path;
+        return false;
+    }
+    std::stringstream ss;
+    ss << f.rdbuf();
+    if (!ParseLayout(ss.str(), width, height, out, error)) {
+        error = std::string(path) + ": " + error;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <rpi-rgb-led-matrix/include/graphics.h>
+#include "shared_state.h"
+
+// Screen layout, loaded from a text file at startup instead of being compiled in.
+//
+// One widget per line, a kind followed by key=value options; '#' starts a comment:
+//
+//   icon     field=cond    x=0  y=0
+//   text     field=temp    x=18 y=10   color=ffff00 suffix=C
+//   scroller field=track   x=0  y=H-12 color=ffffff
+//   bar      field=brightness x=0 y=H-1 w=W h=1 min=0 max=100 color=202020
+//
+// Kinds:
+//   icon      16x16 weather icon for field=cond, x/y is the top left corner. Rain, snow and
+//             thunder animate (see IconFrameAt)
+//   text      static text, x/y is the left end of the baseline. chars=N truncates to
+//             N characters, prefix= and suffix= are added around the value
+//   scroller  marquee across w pixels (default: to the right edge) when the text doesn't fit,
+//             moving at speed= pixels per second (default 20)
+//   bar       w x h bar filled in proportion to a numeric field between min and max
+//
+// Any widget can set how often it is redrawn with rate=:
+//   rate=change  only when its value changes. An icon stays on its first frame, a scroller
+//                shows the start of its text without moving. Default for text and bars.
+//   rate=anim    as often as its content moves: scrollers at --fps, icons at their own frame
+//                times. Default for icons and scrollers.
+//   rate=N       N times a second at most, N up to 120, rounded to whole --fps frames. Value
+//                changes wait for the next slot too, so a chatty sensor costs N frames a second.
+// Widgets are redrawn only when they are due, so static text costs nothing between updates
+// while a marquee next to it runs at full rate.
+//
+// Fields: cond, temp, summary, track, artist, brightness.
+// Coordinates are pixels, or relative to the canvas size as W, H, W-N, H+N and so on,
+// so one layout fits any chain length. Colors are RRGGBB hex. Any text widget can use
+// another BDF font with font=path. Values with spaces can be quoted: suffix=" C".
+
+enum WidgetKind { W_ICON, W_TEXT, W_SCROLLER, W_BAR };
+
+// How often a widget is redrawn (rate=)
+enum RefreshPolicy { REFRESH_CHANGE, REFRESH_ANIMATED, REFRESH_FIXED };
+
+struct WidgetSpec {
+    WidgetKind kind = W_TEXT;
+    StateField field = F_WEATHER_TEMP;
+    int x = 0, y = 0;
+    int w = 0, h = 0;                  // scroller width, bar size
+    rgb_matrix::Color color = rgb_matrix::Color(255, 255, 255);
+    std::string prefix, suffix;        // text
+    int chars = 0;                     // text, 0 = no limit
+    float min = 0, max = 100;          // bar
+    float speed = 20;                  // scroller, pixels per second
+    RefreshPolicy refresh = REFRESH_CHANGE;
+    float rate = 0;                    // REFRESH_FIXED, redraws per second
+    const rgb_matrix::Font *font = nullptr; // nullptr = the renderer's default font
+};
+
+struct Layout {
+    std::vector<WidgetSpec> widgets; // in draw order
+    std::vector<std::unique_ptr<rgb_matrix::Font>> fonts; // loaded by font=, owned here
+};
+
+// The layout used when no file is given
+extern const char *DEFAULT_LAYOUT;
+
+// Parse layout text against a canvas of width x height. On failure returns false and
+// describes the first problem in error.
+bool ParseLayout(const std::string &text, int width, int height, Layout &out, std::string &error);
+bool LoadLayout(const char *path, int width, int height, Layout &out, std::string &error);
@@ -1,66 +1,114 @@
-#include <unistd.h>
 #include <signal.h>
 #include <mosquitto.h>
 #include <rpi-rgb-led-matrix/include/led-matrix.h>
 #include <rpi-rgb-led-matrix/include/graphics.h>
-#include <mutex>
 #include <atomic>
 #include <string>
+#include <utility>
+#include <algorithm>
+#include <thread>
 #include <iostream>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include "icons_weather.h"
 #include "shared_state.h"
+#include "render_scheduler.h"
+#include "renderer.h"
+#include "frame_telemetry.h"
+#include "mqtt_dispatch.h"
+#include "layout.h"
+#include "render_pool.h"
+#include "shm_source.h"
+#include "state_cache.h"
+#include "brightness_ramp.h"
+#include "frame_hash.h"
 
 using namespace rgb_matrix;
 
 // Global state and signals, interrupt is not atomic
 static SharedState gState;
+static RenderScheduler gScheduler; // wakes the render loop on new state or a due frame
 static volatile bool interrupt_received = false;
-static void InterruptHandler(int) { interrupt_received = true; }
-
-// Measure text width
-static int TextWidth(const rgb_matrix::Font &font, const std::string &txt) {
-  int width = 0;
-  for (size_t i = 0; i < txt.size(); ++i) {
-    // NOTE: This treats each byte as a glyph. Real UTF-8 needs decoding, and multi-byte characters will give wrong widths. Only works for ASCII
-    const uint8_t codepoint = static_cast<uint8_t>(txt[i]);
-    width += font.CharacterWidth(codepoint);
-  }
-  return width;
-}
+static void InterruptHandler(int) { interrupt_received = true; gScheduler.Notify(); }
 
-struct ScrollInfo {
-  std::string text;
-  int width = 0; // Total cycle width: = textW if it fits, else textW + GAP
-  int pos   = 0; // X-pos left‑edge in pixels
-};
+// Topic routes, filled in once before connecting
+static TopicDispatcher gTopics;
 
-static ScrollInfo trackScroll;
-static ScrollInfo artistScroll;
+static void AddTopics(TopicDispatcher &d) {
+  // Resolve the icon in the route, once per message, so the render path only sees an icon ID
+  d.AddEnum<IconId>("matrix/weather/cond", ResolveWeatherIcon,
+                    [](IconId icon, std::string_view cond) { return gState.SetWeatherCond(cond, icon); });
+  d.AddString("matrix/weather/temp",    [](std::string_view v) { return gState.Set(F_WEATHER_TEMP, v); });
+  d.AddString("matrix/weather/summary", [](std::string_view v) { return gState.Set(F_WEATHER_SUMMARY, v); });
+  d.AddString("matrix/spotify/track",   [](std::string_view v) { return gState.Set(F_TRACK, v); });
+  d.AddString("matrix/spotify/artist",  [](std::string_view v) { return gState.Set(F_ARTIST, v); });
+  // Brightness is a number 0->100, but we clamp it to 5->100 so the panel never goes dark
+  d.AddInt("matrix/control/brightness", BRIGHTNESS_MIN, BRIGHTNESS_MAX, [](int b) { return gState.SetBrightness(b); });
+}
 
-// MQTT message handler
+// Subscribe on every (re)connect; the network thread reconnects on its own after a drop
+void on_connect(struct mosquitto *m, void *, int rc) {
+  if (rc != 0) {
+    fprintf(stderr, "MQTT connect refused (%d)\n", rc);
+    return;
+  }
+  for (size_t i = 0; i < gTopics.size(); ++i) mosquitto_subscribe(m, nullptr, gTopics.topic(i), 0);
+}
+
+// MQTT message handler. Runs on the mosquitto thread; publishing never blocks the render loop.
 void on_message(struct mosquitto *, void *, const struct mosquitto_message *msg) {
-  std::string topic(msg->topic);
-  std::string payload(reinterpret_cast<char*>(msg->payload), msg->payloadlen);
-
-  std::lock_guard<std::mutex> lk(gState.m);
-  if (topic == "matrix/weather/cond")           gState.weatherCond = payload;
-  else if (topic == "matrix/weather/temp")       gState.weatherTemp = payload;
-  else if (topic == "matrix/weather/summary")    gState.weatherSummary = payload;
-  else if (topic == "matrix/spotify/track")      gState.track = payload;
-  else if (topic == "matrix/spotify/artist")     gState.artist = payload;
-  else if (topic == "matrix/control/brightness") {
-    // Brightness is a number 0->100, but we clamp it to 5->100. This code is unsafe if the payload is not a valid number or is too large of a number.
-    int b = std::stoi(payload);
-    if (b < 5)   b = 5;
-    if (b > 100) b = 100;
-    gState.brightness = b;
+  switch (gTopics.Dispatch(msg->topic, msg->payload, msg->payloadlen)) {
+  case DISPATCH_CHANGED:
+    gScheduler.Notify(); // render right away rather than at the next frame tick
+    break;
+  case DISPATCH_BAD_PAYLOAD:
+    fprintf(stderr, "Ignoring bad payload on %s\n", msg->topic);
+    break;
+  default:
+    break;
   }
-  gState.dirty = true; // force redraw
+}
+
+// Returns the value if arg is "--name=value", nullptr otherwise
+static const char *FlagValue(const char *arg, const char *name) {
+  const size_t n = strlen(name);
+  if (strncmp(arg, "--", 2) != 0 || strncmp(arg + 2, name, n) != 0 || arg[2 + n] != '=') return nullptr;
+  return arg + 3 + n;
+}
+
+static int Usage(const char *prog, const RGBMatrix::Options &matrix_options, const RuntimeOptions &runtime) {
+  fprintf(stderr,
+          "usage: %s [options]\n"
+          "  --coalesce-ms=N        hold a track update up to N ms for its artist, 0 to show each at once (default 250)\n"
+          "  --layout=PATH          screen layout file (default: built in, see layout.h)\n"
+          "  --fps=N                frame rate while text scrolls, up to 120; rate=N in the layout rounds to it (default 60)\n"
+          "  --fade-ms=N            fade brightness changes over N ms, 0 to jump (default 400)\n"
+          "  --gamma=F              extra gamma for icons and text, > 1 darkens midtones (default 1.0)\n"
+          "  --white-balance=R,G,B  per-channel gain 0..1 (default 1,1,1)\n"
+          "  --shm=NAME             show raw frames from other processes via /dev/shm/NAME instead (see shm_frames.h)\n"
+          "  --state-cache=PATH     last known state, shown at startup until MQTT catches up; empty to disable\n"
+          "                         (default /var/tmp/matrix-display.state)\n"
+          "  --render-threads=N     threads drawing large repaints, one panel per tile (default: cores - 1, max 3)\n",
+          prog);
+  PrintMatrixFlags(stderr, matrix_options, runtime);
+  return 1;
+}
+
+// Time from process start to the first frame on the panel, logged once and kept in the
+// telemetry reports
+static int64_t ReportFirstFrame(int64_t start_ns, bool restored, FrameTelemetry &tele) {
+  const int64_t ns = NowNs() - start_ns;
+  fprintf(stderr, "First frame after %.1f ms (%s)\n", ns / 1e6, restored ? "cached state" : "no cached state");
+  tele.SetFirstFrame(ns);
+  return ns;
 }
 
 // main
 int main(int argc, char **argv) {
+  const int64_t start_ns = NowNs(); // for time to first frame
+
   // Signals
   signal(SIGTERM, InterruptHandler);
   signal(SIGINT,  InterruptHandler);
@@ -76,118 +124,268 @@ int main(int argc, char **argv) {
   matrix_options.limit_refresh_rate_hz= 120;
   runtime.drop_privileges             = 1;
 
-  // Supports chaining displays
-  const int DISPLAY_WIDTH = matrix_options.cols * matrix_options.chain_length;
+  // NOTE: Some Waveshare displays swap the G and B channels in hardware, so data interpreted as blue is actually green, and vice versa.
+  // The library remaps channels as it writes each pixel into the panel's bitplanes, so all drawing code below uses true RGB.
+  // This default matches my panel. If yours is not affected, run with --led-rgb-sequence=RGB.
+  matrix_options.led_rgb_sequence     = "RBG";
+
+  // Any --led-* flag overrides the defaults above
+  if (!ParseOptionsFromFlags(&argc, &argv, &matrix_options, &runtime)) {
+    return Usage(argv[0], matrix_options, runtime);
+  }
+
+  // Our own flags, whatever the library didn't consume
+  int coalesce_ms = 250;
+  const char *layout_path = nullptr;
+  int fps = 60;
+  int fade_ms = 400;
+  ColorCalibration calibration;
+  const char *shm_name = nullptr;
+  const char *cache_path = "/var/tmp/matrix-display.state";
+  // Leave a core for the library's refresh thread
+  int render_threads = std::max(1, std::min(3, (int)std::thread::hardware_concurrency() - 1));
+  for (int i = 1; i < argc; ++i) {
+    const char *v;
+    if ((v = FlagValue(argv[i], "coalesce-ms"))) coalesce_ms = atoi(v);
+    else if ((v = FlagValue(argv[i], "layout"))) layout_path = v;
+    else if ((v = FlagValue(argv[i], "fps"))) fps = std::max(1, std::min(120, atoi(v)));
+    else if ((v = FlagValue(argv[i], "fade-ms"))) fade_ms = std::max(0, atoi(v));
+    else if ((v = FlagValue(argv[i], "gamma"))) {
+      calibration.gamma = strtof(v, nullptr);
+      if (!(calibration.gamma > 0.1f && calibration.gamma < 5.0f)) return Usage(argv[0], matrix_options, runtime);
+    }
+    else if ((v = FlagValue(argv[i], "white-balance"))) {
+      float *wb = calibration.white;
+      if (sscanf(v, "%f,%f,%f", &wb[0], &wb[1], &wb[2]) != 3) return Usage(argv[0], matrix_options, runtime);
+    }
+    else if ((v = FlagValue(argv[i], "shm"))) shm_name = v;
+    else if ((v = FlagValue(argv[i], "state-cache"))) cache_path = v;
+    else if ((v = FlagValue(argv[i], "render-threads"))) render_threads = std::max(1, atoi(v));
+    else return Usage(argv[0], matrix_options, runtime);
+  }
+
+  // Home Assistant publishes track and artist as two messages. Hold whichever comes first
+  // until the other arrives (or the window runs out) so both lines change in one frame.
+  gState.SetCoalescing(FieldBit(F_TRACK) | FieldBit(F_ARTIST), coalesce_ms * 1000000LL);
+
+  // Start from the last known state so the first frame has something on it. Opened before
+  // the matrix drops privileges, the mapping stays writable afterwards.
+  StateCache cache;
+  bool restored = false;
+  if (*cache_path) {
+    StateData cached;
+    if (!cache.Open(cache_path)) perror(cache_path);
+    else if ((restored = cache.Load(cached))) gState.Restore(cached);
+  }
 
   RGBMatrix *matrix = CreateMatrixFromOptions(matrix_options, runtime);
-  InitIcons();
   if (matrix == nullptr) return 1;
 
+  // Draw canvas. The layout is resolved against the full canvas, so chained panels just make it wider
+  FrameCanvas *offscreen = matrix->CreateFrameCanvas();
+  Layout layout;
+  std::string layout_error;
+  const bool layout_ok = layout_path
+      ? LoadLayout(layout_path, offscreen->width(), offscreen->height(), layout, layout_error)
+      : ParseLayout(DEFAULT_LAYOUT, offscreen->width(), offscreen->height(), layout, layout_error);
+  if (!layout_ok) {
+    std::cerr << "Layout: " << layout_error << "\n";
+    delete matrix;
+    return 1;
+  }
+  if (!gScheduler.ok()) {
+    std::cerr << "eventfd/timerfd setup failed\n";
+    delete matrix;
+    return 1;
+  }
+
   // Font
   rgb_matrix::Font font;
   if (!font.LoadFont("rpi-rgb-led-matrix/fonts/6x13.bdf")) {
     std::cerr << "Font load failed\n";
+    delete matrix;
     return 1;
   }
 
-  // NOTE: Some Waveshare displays swap the G and B channels in hardware, so data interpreted as blue is actually green, and vice versa. 
-  // This is a workaround to fix that as it affects my panel. If yours is not affected, you can swap the G and B values in the Color constructor below.
-  Color white(255,255,255), green(0,0,255), cyan(0,255,255), yellow(255,0,255);
-
-  // MQTT, right now a failure to connect will not stop the program, but it will not receive any updates.
+  // MQTT. Connects in the background and keeps retrying, so a broker that is down or slow
+  // doesn't hold up the first frame; topics are subscribed in on_connect.
+  AddTopics(gTopics);
   mosquitto_lib_init();
   mosquitto *m = mosquitto_new("matrix-display", true, nullptr);
+  mosquitto_connect_callback_set(m, on_connect);
   mosquitto_message_callback_set(m, on_message);
-  if (mosquitto_connect(m, "192.168.1.71", 1883, 60) != MOSQ_ERR_SUCCESS) {
-    std::cerr << "MQTT connect failed\n";
+  mosquitto_reconnect_delay_set(m, 1, 30, true);
+  if (mosquitto_connect_async(m, "192.168.1.71", 1883, 60) != MOSQ_ERR_SUCCESS) {
+    std::cerr << "MQTT connect failed, retrying in the background\n";
   }
-  const char *topics[] = {
-    "matrix/weather/cond", "matrix/weather/temp", "matrix/weather/summary",
-    "matrix/spotify/track", "matrix/spotify/artist", "matrix/control/brightness"
-  };
-  for (auto t : topics) mosquitto_subscribe(m, nullptr, t, 0);
   mosquitto_loop_start(m);
 
-  // Draw canvas and scroll positions
-  FrameCanvas *offscreen = matrix->CreateFrameCanvas();
-  trackScroll.pos  = DISPLAY_WIDTH;
-  artistScroll.pos = DISPLAY_WIDTH;
+  DisplayRenderer renderer(font, offscreen->width(), offscreen->height(), std::move(layout));
+  renderer.SetCalibration(calibration);
+
+  // Raw frame input from other local processes. Replaces the renderer; MQTT still controls brightness.
+  ShmFrameSource shm;
+  if (shm_name && !shm.Open(shm_name, offscreen->width(), offscreen->height())) {
+    perror("shm");
+    delete matrix;
+    return 1;
+  }
+
+  // Long chains repaint in parallel, one panel per tile, and tiles only ever split on panel
+  // boundaries. A pixel mapper, or --led-multiplexing (which the library applies as one,
+  // moving x around within a panel), can fold two columns of the canvas onto one column of
+  // the panel, which would put two threads on the same framebuffer words, so tiling is off
+  // when either is set. A single panel is one tile, so it needs no pool either.
+  const int tile_width = matrix_options.cols;
+  if ((matrix_options.pixel_mapper_config && *matrix_options.pixel_mapper_config) ||
+      matrix_options.multiplexing != 0 || offscreen->width() <= tile_width) {
+    render_threads = 1;
+  }
+  RenderPool pool(render_threads);
+  renderer.SetTiling(&pool, tile_width);
+
+  const int64_t FRAME_PERIOD_NS = 1000000000LL / fps; // marquee frame rate, scroll speed is per line in the layout
+  renderer.SetFramePeriod(FRAME_PERIOD_NS);
+  const int64_t TELEMETRY_PERIOD_NS = 10LL * 1000 * 1000 * 1000; // publish frame stats every 10 s
+  int lastBrightness = -1;
+
+  // Brightness fades on its own deadline, so it also runs while nothing else is drawing.
+  // Steps are at most one per frame period.
+  BrightnessRamp brightness(fade_ms * 1000000LL, FRAME_PERIOD_NS);
+
+  // Render loop's copy of the state, strings are only copied when their generation changes
+  StateData snapshot;
 
-  constexpr int GAP = 10; // pixels between repeated copies
-  const int FRAME_DELAY_US = 50 * 1000; // 20 fps, 50 ms per frame
+  // In shm mode each frame tick polls the ring for a new frame. The renderer schedules its
+  // own frames, per widget.
+  FramePacer pacer(FRAME_PERIOD_NS);
+  if (shm_name) pacer.Start(NowNs());
+  gScheduler.Notify(); // draw the first frame straight away
+
+  // Render loop timing, published on matrix/tele/frame (see frame_telemetry.h to compile it out)
+  FrameTelemetry tele(TELEMETRY_PERIOD_NS);
+  tele.Start(TelemetryNow());
+  int64_t changedNs = 0; // publish time of the oldest state change not yet on screen
+
+  // Key of the frame on screen, so a frame that would look the same isn't swapped in
+  FrameDedup dedup;
+  int64_t first_frame_ns = -1;
 
   while (!interrupt_received) {
-    // Check if we need to render by evaluating dirty state
-    bool do_render = false;
-    {
-      std::lock_guard<std::mutex> lk(gState.m);
-      if (gState.dirty) { do_render = true; gState.dirty = false; }
+    // Sleep until MQTT publishes new state, a widget is due (scroll step, icon animation frame,
+    // the next slot of a rate-limited widget), a held track/artist update times out or stats are due
+    const int64_t widgetDue = shm_name ? -1 : renderer.NextDue();
+    gScheduler.WaitUntil(EarliestDeadline(EarliestDeadline(pacer.deadline(), gState.commit_deadline()),
+                                          EarliestDeadline(EarliestDeadline(tele.deadline(), widgetDue),
+                                                           brightness.deadline())));
+    if (interrupt_received) break;
+
+    // A track without its artist (or vice versa) within the window goes out on its own
+    gState.CommitExpired(NowNs());
+
+    // Check if we need to render, lock-free
+    const int64_t t_snap = TelemetryNow();
+    const bool fresh = gState.Snapshot(snapshot);
+    bool do_render = fresh;
+    if (do_render && changedNs == 0) changedNs = snapshot.changedNs;
+
+    // A shm poll or a widget is due. Widgets only move when their own deadline passes, so
+    // this frame redraws those and nothing else. Marquee positions come from the clock, so
+    // state changes in between can render straight away and a late frame just lands further along.
+    const int64_t now = NowNs();
+    tele.Record(FrameTelemetry::T_SNAPSHOT, now - t_snap);
+    if (pacer.Due(now)) {
+      tele.Record(FrameTelemetry::T_LATE, now - pacer.deadline());
+      tele.FramesSkipped(pacer.Advance(now));
+      do_render = true;
+    }
+    if (widgetDue >= 0 && now >= widgetDue) {
+      tele.Record(FrameTelemetry::T_LATE, now - widgetDue);
+      tele.FramesSkipped((int)((now - widgetDue) / FRAME_PERIOD_NS));
+      do_render = true;
     }
 
-    // If either line's stored width exceeds display width, keep rendering to scroll
-    const bool scrolling_active = (trackScroll.width > DISPLAY_WIDTH) ||
-                                  (artistScroll.width > DISPLAY_WIDTH);
-
-    if (scrolling_active) do_render = true;
-
-    if (do_render) {
-      // Apply latest MQTT brightness safely (grab under lock inside a lambda). Right now only checked while rendering is active.
-      // This is to ensure that brightness changes are applied without blocking the main loop.
-      matrix->SetBrightness([]{
-        std::lock_guard<std::mutex> lk(gState.m);
-        return gState.brightness;
-      }());
-
-      offscreen->Clear();
-
-      SharedState snapshot; SnapshotState(gState, snapshot);
-
-      // Update scroll metadata if text changed 
-      auto update_scroll = [&](ScrollInfo &si, const std::string &newText) {
-        if (newText == si.text) return;
-        si.text = newText;
-        const int textW = TextWidth(font, si.text);
-        si.width = (textW <= DISPLAY_WIDTH) ? textW : textW + GAP;
-        si.pos   = DISPLAY_WIDTH;
-      };
-
-      update_scroll(trackScroll,  snapshot.track);
-      update_scroll(artistScroll, snapshot.artist);
-      
-
-      // Draw the weather icon with text
-      DrawWeatherIcon(snapshot.weatherCond, offscreen, 0, 0);
-      DrawText(offscreen, font, 18, 10, yellow, nullptr,
-               (snapshot.weatherTemp + "C").c_str());
-      DrawText(offscreen, font, 0, 22, cyan, nullptr,
-               snapshot.weatherSummary.substr(0, 20).c_str());
-
-      // Printing track and artist from Spotify
-      const int TRACK_Y  = 32 - 12;
-      const int ARTIST_Y = 32 - 1;
-      
-      // Helper to draw (and scroll) a line of text. "si" holds scroll state; "col" is the color; "y" is the baseline.
-      auto draw_scrolling = [&](ScrollInfo &si, const Color &col, int y) {
-        if (si.text.empty()) return;
-        if (si.width <= DISPLAY_WIDTH) {
-          DrawText(offscreen, font, 0, y, col, nullptr, si.text.c_str());
-        } else {
-          DrawText(offscreen, font, si.pos, y, col, nullptr, si.text.c_str());
-          DrawText(offscreen, font, si.pos + si.width, y, col, nullptr,
-                   si.text.c_str());
-          if (--si.pos + si.width < 0) si.pos += si.width; // seamless wrap
+    // A new MQTT brightness starts a fade; the snapshot is only compared, no lock is taken
+    if (snapshot.brightness != brightness.target()) brightness.SetTarget(snapshot.brightness, now);
+    if (brightness.Due(now)) do_render = true;
+
+    if (do_render && shm_name) {
+      const int level = brightness.Level(now);
+      if (level != lastBrightness) {
+        matrix->SetBrightness(level);
+        lastBrightness = level;
+        shm.Invalidate(); // copy the current frame again at the new brightness
+      }
+      // Newest complete frame from the ring, straight into the offscreen canvas. Producers
+      // often send the same frame again; that one stays off the panel. It's told apart by its
+      // RGB as the producer wrote it, plus the level it was copied at.
+      const int64_t t_copy = TelemetryNow();
+      if (shm.CopyLatest(offscreen)) {
+        if (dedup.OnScreen(HashMix(shm.hash(), (uint64_t)level))) {
+          shm.Shown(NowNs()); // it's on the panel already
+          tele.Record(FrameTelemetry::T_RENDER, TelemetryNow() - t_copy);
+          tele.SwapDeduped();
+        }
+        else {
+          const int64_t t_swap = TelemetryNow();
+          offscreen = matrix->SwapOnVSync(offscreen);
+          const int64_t t_shown = NowNs();
+          shm.Shown(t_shown);
+          tele.Record(FrameTelemetry::T_RENDER, t_swap - t_copy);
+          tele.Record(FrameTelemetry::T_SWAP, t_shown - t_swap);
+          tele.Record(FrameTelemetry::T_LATENCY, t_shown - shm.stamp_ns());
+          tele.FrameShown();
+          if (first_frame_ns < 0) first_frame_ns = ReportFirstFrame(start_ns, restored, tele);
         }
-      };
+      }
+      changedNs = 0;
+    }
+    else if (do_render) {
+      renderer.Tick(now);
 
-      draw_scrolling(trackScroll,  white,  TRACK_Y);
-      draw_scrolling(artistScroll, green,  ARTIST_Y);
+      // Apply the fade's current level, only when it moved. Brightness is baked in when pixels
+      // are set, so a change repaints everything, through a color table rebuilt for the level.
+      const int level = brightness.Level(now);
+      if (level != lastBrightness) {
+        matrix->SetBrightness(level);
+        lastBrightness = level;
+        renderer.SetBrightness(level);
+      }
 
-      // Swap offscreen to visible frame (double-buffered, synced to VSync)
-      offscreen = matrix->SwapOnVSync(offscreen);
+      // Only draw and swap if something on screen actually changed
+      const int64_t t_render = TelemetryNow();
+      if (renderer.Update(snapshot)) {
+        // A frame for new state can still look just like the one on screen, e.g. a value that
+        // changed but prints the same. The frame key tells without drawing anything, and that
+        // frame is neither drawn nor swapped in.
+        if (dedup.OnScreen(renderer.FrameKey())) {
+          tele.Record(FrameTelemetry::T_RENDER, TelemetryNow() - t_render);
+          tele.SwapDeduped();
+        }
+        else {
+          renderer.Draw(offscreen);
+          const int64_t t_swap = TelemetryNow();
+          // Swap offscreen to visible frame (double-buffered, synced to VSync)
+          offscreen = matrix->SwapOnVSync(offscreen);
+          const int64_t t_shown = TelemetryNow();
+          tele.Record(FrameTelemetry::T_RENDER, t_swap - t_render);
+          tele.Record(FrameTelemetry::T_SWAP, t_shown - t_swap);
+          tele.FrameShown();
+          if (changedNs != 0) tele.Record(FrameTelemetry::T_LATENCY, t_shown - changedNs);
+          if (first_frame_ns < 0) first_frame_ns = ReportFirstFrame(start_ns, restored, tele);
+        }
+      }
+      changedNs = 0; // shown, or it changed nothing visible
     }
 
+    // Keep the last known state for the next start, off the path to the swap
+    if (fresh) cache.Save(snapshot);
 
-    usleep(FRAME_DELAY_US);
+    if (tele.Due(now)) {
+      // mosquitto_publish only queues the message for the network thread
+      const std::string report = tele.Report(now);
+      mosquitto_publish(m, nullptr, "matrix/tele/frame", (int)report.size(), report.data(), 0, false);
+    }
   }
 
   // Cleanup -------------------------------------------------------------------
@@ -0,0 +1,120 @@
+#include "mqtt_dispatch.h"
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <locale.h>
+
+namespace {
+
+// FNV-1a over a NUL-terminated topic
+uint32_t TopicHash(const char *s) {
+    uint32_t h = 2166136261u;
+    for (; *s; ++s) {
+        h ^= (uint8_t)*s;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+std::string_view Trim(std::string_view s) {
+    const char *ws = " \t\r\n";
+    const size_t b = s.find_first_not_of(ws);
+    if (b == std::string_view::npos) return std::string_view();
+    return s.substr(b, s.find_last_not_of(ws) - b + 1);
+}
+
+// Trimmed payload without a leading '+', which from_chars doesn't take
+std::string_view Number(std::string_view payload) {
+    payload = Trim(payload);
+    if (!payload.empty() && payload[0] == '+') payload.remove_prefix(1);
+    return payload;
+}
+
+// Always '.' as the decimal point, whatever locale the process runs under
+locale_t CLocale() {
+    static const locale_t c = newlocale(LC_ALL_MASK, "C", (locale_t)0);
+    return c;
+}
+
+}
+
+bool ParsePayloadInt(std::string_view payload, int &out) {
+    payload = Number(payload);
+    if (payload.empty()) return false;
+    int v;
+    const auto r = std::from_chars(payload.data(), payload.data() + payload.size(), v);
+    if (r.ec != std::errc() || r.ptr != payload.data() + payload.size()) return false;
+    out = v;
+    return true;
+}
+
+// strtof_l rather than from_chars: libstdc++ only has floating point from_chars from GCC 11,
+// and Raspberry Pi OS Bullseye ships GCC 10. The payload is copied to terminate it; anything
+// longer than a number could reasonably be is rejected, as are hex floats, which from_chars
+// wouldn't take either.
+bool ParsePayloadFloat(std::string_view payload, float &out) {
+    payload = Number(payload);
+    char buf[32];
+    if (payload.empty() || payload.size() >= sizeof(buf) ||
+        payload.find_first_of("xX") != std::string_view::npos) return false;
+    memcpy(buf, payload.data(), payload.size());
+    buf[payload.size()] = '\0';
+    char *end;
+    const float v = strtof_l(buf, &end, CLocale());
+    if (end != buf + payload.size() || !std::isfinite(v)) return false;
+    out = v;
+    return true;
+}
+
+void TopicDispatcher::AddString(const char *topic, StringHandler fn) {
+    Add(topic, [fn](std::string_view p) { return fn(p) ? DISPATCH_CHANGED : DISPATCH_UNCHANGED; });
+}
+
+void TopicDispatcher::AddInt(const char *topic, int lo, int hi, IntHandler fn) {
+    Add(topic, [lo, hi, fn](std::string_view p) {
+        int v;
+        if (!ParsePayloadInt(p, v)) return DISPATCH_BAD_PAYLOAD;
+        if (v < lo) v = lo;
+        if (v > hi) v = hi;
+        return fn(v) ? DISPATCH_CHANGED : DISPATCH_UNCHANGED;
+    });
+}
+
+void TopicDispatcher::AddFloat(const char *topic, FloatHandler fn) {
+    Add(topic, [fn](std::string_view p) {
+        float v;
+        if (!ParsePayloadFloat(p, v)) return DISPATCH_BAD_PAYLOAD;
+        return fn(v) ? DISPATCH_CHANGED : DISPATCH_UNCHANGED;
+    });
+}
+
+void TopicDispatcher::Add(const char *topic, RouteFn fn) {
+    routes_.push_back({ topic, TopicHash(topic), std::move(fn) });
+    Rebuild();
+}
+
+// Keep the index at most half full so probe chains stay short
+void TopicDispatcher::Rebuild() {
+    size_t n = 8;
+    while (n < routes_.size() * 2) n *= 2;
+    index_.assign(n, -1);
+    for (size_t i = 0; i < routes_.size(); ++i) {
+        size_t slot = routes_[i].hash & (n - 1);
+        while (index_[slot] >= 0) slot = (slot + 1) & (n - 1);
+        index_[slot] = (int16_t)i;
+    }
+}
+
+DispatchResult TopicDispatcher::Dispatch(const char *topic, const void *payload, size_t len) const {
+    if (routes_.empty()) return DISPATCH_UNKNOWN_TOPIC;
+    const uint32_t h = TopicHash(topic);
+    const size_t mask = index_.size() - 1;
+    for (size_t slot = h & mask; index_[slot] >= 0; slot = (slot + 1) & mask) {
+        const Route &r = routes_[index_[slot]];
+        if (r.hash == h && r.topic == topic) {
+            return r.fn(std::string_view(static_cast<const char *>(payload), len));
+        }
+    }
+    return DISPATCH_UNKNOWN_TOPIC;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Parse a whole payload as a number, ignoring surrounding whitespace. Never throws;
+// returns false on anything that isn't entirely a number in range of the type.
+bool ParsePayloadInt(std::string_view payload, int &out);
+bool ParsePayloadFloat(std::string_view payload, float &out);
+
+enum DispatchResult {
+    DISPATCH_UNKNOWN_TOPIC,
+    DISPATCH_BAD_PAYLOAD,
+    DISPATCH_UNCHANGED,
+    DISPATCH_CHANGED
+};
+
+// Table-driven MQTT topic routing. Topics are registered (and hashed) once at startup with a
+// typed handler; Dispatch() hashes the incoming topic in place, finds its route with one probe
+// in the usual case, parses the payload and calls the handler. Nothing is allocated per message.
+// Parsing and any lookups happen in the route before the handler runs, so handlers only take
+// a lock for the final store. Routes must all be added before the first Dispatch().
+class TopicDispatcher {
+public:
+    // Handlers return true if the value changed
+    using StringHandler = std::function<bool(std::string_view)>;
+    using IntHandler    = std::function<bool(int)>;
+    using FloatHandler  = std::function<bool(float)>;
+
+    // Raw payload text
+    void AddString(const char *topic, StringHandler fn);
+    // Integer payload, clamped to [lo, hi]
+    void AddInt(const char *topic, int lo, int hi, IntHandler fn);
+    // Floating point payload, NaN and infinities are rejected
+    void AddFloat(const char *topic, FloatHandler fn);
+    // Text payload mapped to an enum by `resolve`; the handler gets both
+    template <typename E>
+    void AddEnum(const char *topic, E (*resolve)(const char *, size_t),
+                 std::function<bool(E, std::string_view)> fn) {
+        Add(topic, [resolve, fn](std::string_view p) {
+            return fn(resolve(p.data(), p.size()), p) ? DISPATCH_CHANGED : DISPATCH_UNCHANGED;
+        });
+    }
+
+    DispatchResult Dispatch(const char *topic, const void *payload, size_t len) const;
+
+    size_t size() const { return routes_.size(); }
+    const char *topic(size_t i) const { return routes_[i].topic.c_str(); }
+
+private:
+    using RouteFn = std::function<DispatchResult(std::string_view)>;
+    struct Route {
+        std::string topic;
+        uint32_t hash;
+        RouteFn fn;
+    };
+
+    void Add(const char *topic, RouteFn fn);
+    void Rebuild();
+
+    std::vector<Route> routes_;
+    std::vector<int16_t> index_; // open addressing, route index or -1, size is a power of two
+};
@@ -0,0 +1,54 @@
+#include "render_pool.h"
+
+RenderPool::RenderPool(int threads) {
+    for (int i = 1; i < threads; ++i) workers_.emplace_back(&RenderPool::Worker, this);
+}
+
+RenderPool::~RenderPool() {
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        stop_ = true;
+    }
+    start_cv_.notify_all();
+    for (std::thread &t : workers_) t.join();
+}
+
+// Claim and run tiles until there are none left
+void RenderPool::Work() {
+    for (int i; (i = next_.fetch_add(1, std::memory_order_relaxed)) < count_; ) call_(ctx_, i);
+}
+
+void RenderPool::RunJob(int count, Call call, void *ctx) {
+    if (workers_.empty() || count <= 1) {
+        for (int i = 0; i < count; ++i) call(ctx, i);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        call_  = call;
+        ctx_   = ctx;
+        count_ = count;
+        next_.store(0, std::memory_order_relaxed);
+        busy_  = (int)workers_.size();
+        ++generation_;
+    }
+    start_cv_.notify_all();
+    Work();
+
+    std::unique_lock<std::mutex> lk(m_);
+    done_cv_.wait(lk, [this] { return busy_ == 0; });
+}
+
+void RenderPool::Worker() {
+    unsigned seen = 0;
+    std::unique_lock<std::mutex> lk(m_);
+    while (true) {
+        start_cv_.wait(lk, [&] { return stop_ || generation_ != seen; });
+        if (stop_) return;
+        seen = generation_;
+        lk.unlock();
+        Work();
+        lk.lock();
+        if (--busy_ == 0) done_cv_.notify_one();
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small persistent thread pool for splitting a frame into tiles.
+// Workers are started once and sleep on a condition variable between frames, so a frame
+// costs one wakeup per worker rather than thread creation. The calling thread renders
+// tiles too, and Run() only returns once every tile is done, so the caller still does
+// exactly one swap per frame.
+class RenderPool {
+public:
+    // threads is the total including the caller, so 1 means no workers at all
+    explicit RenderPool(int threads);
+    ~RenderPool();
+    RenderPool(const RenderPool &) = delete;
+    RenderPool &operator=(const RenderPool &) = delete;
+
+    int threads() const { return (int)workers_.size() + 1; }
+
+    // Call fn(i) for every i in [0, count), spread over the pool. Tiles are handed out
+    // one at a time, so uneven tiles balance out. Blocks until all of them have run.
+    template <typename Fn>
+    void Run(int count, Fn &fn) {
+        RunJob(count, [](void *ctx, int i) { (*static_cast<Fn *>(ctx))(i); }, &fn);
+    }
+
+private:
+    using Call = void (*)(void *, int);
+
+    void RunJob(int count, Call call, void *ctx);
+    void Work();
+    void Worker();
+
+    std::vector<std::thread> workers_;
+    std::mutex m_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+
+    // Current job, guarded by m_ apart from next_
+    Call call_ = nullptr;
+    void *ctx_ = nullptr;
+    int count_ = 0;
+    std::atomic<int> next_{0};
+    int busy_ = 0;             // workers still on the current job
+    unsigned generation_ = 0;  // bumped per job so workers can tell a new one from a spurious wakeup
+    bool stop_ = false;
+};
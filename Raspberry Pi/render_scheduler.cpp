@@ -0,0 +1,64 @@
+#include "render_scheduler.h"
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include <time.h>
+#include <cerrno>
+
+int64_t NowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+RenderScheduler::RenderScheduler() {
+    event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+}
+
+RenderScheduler::~RenderScheduler() {
+    if (event_fd_ >= 0) close(event_fd_);
+    if (timer_fd_ >= 0) close(timer_fd_);
+}
+
+void RenderScheduler::Notify() {
+    // write() is async-signal-safe, so this is fine from the interrupt handler too
+    const uint64_t one = 1;
+    ssize_t r = write(event_fd_, &one, sizeof(one));
+    (void)r; // EAGAIN means the counter is already non-zero, i.e. a wakeup is pending anyway
+}
+
+bool RenderScheduler::WaitUntil(int64_t deadline_ns) {
+    // Only reprogram the timer when the deadline moves
+    if (deadline_ns != armed_) {
+        struct itimerspec its = {};
+        if (deadline_ns >= 0) {
+            // A zero it_value disarms, so clamp "already due" to 1 ns
+            const int64_t d = deadline_ns > 0 ? deadline_ns : 1;
+            its.it_value.tv_sec  = d / 1000000000LL;
+            its.it_value.tv_nsec = d % 1000000000LL;
+        }
+        timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &its, nullptr);
+        armed_ = deadline_ns;
+    }
+
+    struct pollfd fds[2] = {
+        { event_fd_, POLLIN, 0 },
+        { timer_fd_, POLLIN, 0 },
+    };
+    // EINTR (signal) just returns, the caller checks its interrupt flag
+    if (poll(fds, 2, -1) < 0 && errno != EINTR) return false;
+
+    uint64_t count;
+    bool notified = false;
+    if (fds[0].revents & POLLIN) {
+        notified = read(event_fd_, &count, sizeof(count)) == sizeof(count);
+    }
+    if (fds[1].revents & POLLIN) {
+        ssize_t r = read(timer_fd_, &count, sizeof(count));
+        (void)r;
+        armed_ = -1; // one-shot timer has expired
+    }
+    return notified;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+
+// Monotonic clock in nanoseconds
+int64_t NowNs();
+
+// Earliest of two deadlines where negative means none
+inline int64_t EarliestDeadline(int64_t a, int64_t b) {
+    if (a < 0) return b;
+    if (b < 0) return a;
+    return a < b ? a : b;
+}
+
+// Blocks the render loop until there is something to do.
+// Wakes on Notify() (new MQTT state, shutdown) via an eventfd, or at an absolute deadline
+// via a timerfd that is only armed while something needs animating. With nothing to
+// animate the loop sleeps in poll() and costs no CPU.
+class RenderScheduler {
+public:
+    RenderScheduler();
+    ~RenderScheduler();
+    RenderScheduler(const RenderScheduler &) = delete;
+    RenderScheduler &operator=(const RenderScheduler &) = delete;
+
+    bool ok() const { return event_fd_ >= 0 && timer_fd_ >= 0; }
+
+    // Wake the render loop. Safe from any thread and from a signal handler.
+    void Notify();
+
+    // Block until Notify() is called or the absolute monotonic deadline passes.
+    // A negative deadline disarms the timer and waits for Notify() only.
+    // Returns true if woken by Notify().
+    bool WaitUntil(int64_t deadline_ns);
+
+private:
+    int event_fd_ = -1;
+    int timer_fd_ = -1;
+    int64_t armed_ = -1; // deadline currently programmed into the timerfd
+};
+
+// Frame pacing against absolute deadlines: frame k is due at start + k * period no matter
+// how long each frame took to render, so work time doesn't stretch the frame interval.
+// If we fall more than a frame behind, the missed frames are skipped (and counted)
+// instead of rendered back to back.
+class FramePacer {
+public:
+    explicit FramePacer(int64_t period_ns) : period_(period_ns) {}
+
+    bool running() const { return running_; }
+    int64_t deadline() const { return running_ ? deadline_ : -1; }
+    int64_t period() const { return period_; }
+
+    void Start(int64_t now) {
+        if (running_) return;
+        running_ = true;
+        deadline_ = now + period_;
+    }
+    void Stop() { running_ = false; }
+
+    // True if a frame is due at `now`
+    bool Due(int64_t now) const { return running_ && now >= deadline_; }
+
+    // Consume the due frame and schedule the next one. Returns how many frames were skipped.
+    int Advance(int64_t now) {
+        int skipped = 0;
+        deadline_ += period_;
+        if (now >= deadline_) {
+            skipped = (int)((now - deadline_) / period_) + 1;
+            deadline_ += (int64_t)skipped * period_;
+        }
+        return skipped;
+    }
+
+private:
+    int64_t period_;
+    int64_t deadline_ = 0;
+    bool running_ = false;
+};
@@ -0,0 +1,341 @@
+#include "renderer.h"
+#include "icons_weather.h"
+#include "mqtt_dispatch.h"
+#include "render_scheduler.h"
+#include "frame_hash.h"
+
+using rgb_matrix::Canvas;
+
+namespace {
+
+constexpr int GAP = 10; // pixels between repeated copies
+constexpr int SUBPIXEL = 256; // scroll positions are kept in 1/256 px
+
+// Below this many damaged pixels waking the pool costs more than drawing on one thread,
+// which covers the usual scroll frame of one or two marquee bands on a short chain
+constexpr int PARALLEL_MIN_AREA = 64 * 32;
+
+// DEFAULT_LAYOUT is known good, so this can't fail
+Layout BuiltInLayout(int width, int height) {
+    Layout layout;
+    std::string error;
+    ParseLayout(DEFAULT_LAYOUT, width, height, layout, error);
+    return layout;
+}
+
+// First step of a grid of period-long steps from clock zero that comes after t
+int64_t GridAfter(int64_t t, int64_t period) {
+    return (t / period + 1) * period;
+}
+
+// Stale values (restored from the state cache) are drawn at half intensity
+rgb_matrix::Color Dim(const rgb_matrix::Color &c) {
+    return rgb_matrix::Color(c.r >> 1, c.g >> 1, c.b >> 1);
+}
+
+// Text shown for a field, the brightness as a number
+std::string FieldText(const StateData &state, StateField f) {
+    if (f == F_BRIGHTNESS) return std::to_string(state.brightness);
+    return state.*kStringFields[f];
+}
+
+}
+
+DisplayRenderer::DisplayRenderer(const rgb_matrix::Font &font, int width, int height)
+    : DisplayRenderer(font, width, height, BuiltInLayout(width, height)) {}
+
+DisplayRenderer::DisplayRenderer(const rgb_matrix::Font &font, int width, int height, Layout layout)
+    : font_(font), width_(width), height_(height), layout_(std::move(layout)) {
+    widgets_.resize(layout_.widgets.size());
+    for (size_t i = 0; i < widgets_.size(); ++i) {
+        Widget &w = widgets_[i];
+        w.spec    = layout_.widgets[i];
+        w.font    = w.spec.font ? w.spec.font : &font_;
+        FontCache &fc = CacheFor(w.font);
+        w.measure = fc.measure.get();
+        w.atlas   = fc.atlas.get();
+        w.pos     = w.spec.w * SUBPIXEL;
+    }
+    SetFramePeriod(frame_period_);
+}
+
+DisplayRenderer::FontCache &DisplayRenderer::CacheFor(const rgb_matrix::Font *font) {
+    for (FontCache &f : fonts_) {
+        if (f.font == font) return f;
+    }
+    fonts_.push_back(FontCache{ font, std::make_unique<TextMeasurer>(*font), std::make_unique<GlyphAtlas>(*font) });
+    return fonts_.back();
+}
+
+void DisplayRenderer::SetFramePeriod(int64_t period_ns) {
+    frame_period_ = period_ns > 0 ? period_ns : 1;
+    for (Widget &w : widgets_) {
+        switch (w.spec.refresh) {
+        case REFRESH_FIXED: {
+            // Whole frames, so fixed-rate widgets share the frames the marquees draw anyway
+            const int64_t frames = (int64_t)(1e9 / w.spec.rate / frame_period_ + 0.5);
+            w.period = (frames > 1 ? frames : 1) * frame_period_;
+            break;
+        }
+        case REFRESH_ANIMATED:
+            // Icons go by their own frame times instead
+            w.period = w.spec.kind == W_SCROLLER ? frame_period_ : 0;
+            break;
+        case REFRESH_CHANGE:
+            w.period = 0;
+            break;
+        }
+        Schedule(w);
+    }
+}
+
+void DisplayRenderer::Tick(int64_t now_ns) {
+    now_ = now_ns;
+    for (Widget &w : widgets_) {
+        // Anything not due keeps its frame and position, so it isn't redrawn
+        if (w.due < 0 || now_ < w.due || !Moves(w)) continue;
+        w.refreshed = now_;
+        if (w.spec.kind == W_ICON) {
+            // A new frame only damages the icon's own box
+            int64_t until;
+            const int frame = IconFrameAt((IconId)w.value, now_ - w.animStart, &until);
+            if (frame != w.frame) w.changed = true;
+            w.frame = frame;
+            w.frameDue = until < 0 ? -1 : now_ + until;
+        }
+        if (!Scrolls(w)) continue;
+        // Text enters at the right edge and moves left; once it has gone a whole cycle past
+        // the left edge it wraps around by a cycle, seamlessly, thanks to the second copy
+        const int64_t cycle = (int64_t)w.cycle * SUBPIXEL;
+        const int64_t moved = (int64_t)((double)(now_ - w.scrollStart) * w.spec.speed * SUBPIXEL / 1e9);
+        int64_t pos = (int64_t)w.spec.w * SUBPIXEL - (moved > 0 ? moved : 0);
+        if (pos < -cycle) pos = -((-pos - 1) % cycle) - 1;
+        w.pos = (int)pos;
+    }
+}
+
+int64_t DisplayRenderer::NextDue() const {
+    int64_t due = -1;
+    for (const Widget &w : widgets_) due = EarliestDeadline(due, w.due);
+    return due;
+}
+
+// Pick up a new value of the widget's field. Only called when the field's generation moved,
+// so unchanged text is never re-measured or re-rasterized.
+void DisplayRenderer::Bind(Widget &w, const StateData &state) {
+    const WidgetSpec &s = w.spec;
+    w.gen  = state.gen[s.field];
+    w.seen = true;
+    const bool stale = (state.stale & FieldBit(s.field)) != 0;
+    if (stale != w.stale) w.changed = true;
+    w.stale = stale;
+
+    switch (s.kind) {
+    case W_ICON: {
+        // A new icon starts its animation from the first frame; the same one sent again keeps going
+        if (w.drawn && w.value == state.weatherIcon) return;
+        int64_t until;
+        w.changed   = true;
+        w.value     = state.weatherIcon;
+        w.animStart = now_;
+        w.frame     = IconFrameAt((IconId)w.value, 0, &until);
+        w.frameDue  = until < 0 ? -1 : now_ + until;
+        return;
+    }
+
+    case W_BAR: {
+        float v = s.min;
+        if (s.field == F_BRIGHTNESS) v = (float)state.brightness;
+        else ParsePayloadFloat(state.*kStringFields[s.field], v);
+        float frac = (v - s.min) / (s.max - s.min);
+        if (frac < 0) frac = 0;
+        if (frac > 1) frac = 1;
+        const int fill = (int)(frac * s.w + 0.5f);
+        if (fill != w.value) w.changed = true;
+        w.value = fill;
+        return;
+    }
+
+    case W_TEXT:
+    case W_SCROLLER: {
+        std::string text = FieldText(state, s.field);
+        if (s.chars > 0) text.resize(Utf8Prefix(text, s.chars));
+        if (!s.prefix.empty() || !s.suffix.empty()) text = s.prefix + text + s.suffix;
+        if (text == w.text && !w.strip.empty()) return;
+        w.text = std::move(text);
+        w.changed = true;
+
+        const int textW = w.measure->Width(w.text);
+        w.cycle = (s.kind == W_TEXT || textW <= s.w) ? textW : textW + GAP;
+        // A marquee enters from the right; one that never moves shows the start of its text
+        w.pos   = s.refresh == REFRESH_CHANGE ? 0 : s.w * SUBPIXEL;
+        w.scrollStart = now_;
+        w.strip.Rasterize(*w.atlas, w.text, w.cycle);
+        return;
+    }
+    }
+}
+
+// Work out where the widget is this frame and damage it if anything moved or changed
+void DisplayRenderer::Place(Widget &w) {
+    const WidgetSpec &s = w.spec;
+    int x = s.x * SUBPIXEL;
+    Rect box;
+    switch (s.kind) {
+    case W_ICON:
+        box = MakeRect(s.x, s.y, 16, 16);
+        break;
+    case W_BAR:
+        box = MakeRect(s.x, s.y, s.w, s.h);
+        break;
+    case W_TEXT:
+        box = w.strip.Box(s.x, s.y);
+        break;
+    case W_SCROLLER:
+        // Scrolling lines damage their whole band, static ones only their text
+        if (Scrolls(w)) {
+            x = s.x * SUBPIXEL + w.pos;
+            box = MakeRect(s.x, s.y - w.font->baseline(), s.w, w.font->height());
+        } else {
+            box = w.strip.Box(s.x, s.y);
+        }
+        break;
+    }
+
+    if (w.drawn && !w.changed && x == w.drawnX && box == w.box) return;
+    if (w.drawn) damage_.Add(w.box);
+    damage_.Add(box);
+    w.drawnX  = x;
+    w.box     = box;
+    w.drawn   = !box.Empty();
+    w.changed = false;
+    w.refreshed = now_;
+}
+
+// Work out when the widget next needs a frame
+void DisplayRenderer::Schedule(Widget &w) {
+    int64_t due = -1;
+    if (Moves(w)) {
+        // An animated icon changes frame at the first step of the grid at or after its frame time
+        due = w.period > 0 ? GridAfter(w.refreshed, w.period) : GridAfter(w.frameDue - 1, frame_period_);
+    }
+    if (w.pending) due = EarliestDeadline(due, GridAfter(w.refreshed, w.period));
+    w.due = due;
+}
+
+bool DisplayRenderer::Update(const StateData &state) {
+    damage_.Clear();
+    if (damage_all_) {
+        damage_.Add(MakeRect(0, 0, width_, height_));
+        damage_all_ = false;
+    }
+
+    // Work out what changed since the last frame
+    for (Widget &w : widgets_) {
+        if (!w.seen || state.gen[w.spec.field] != w.gen) {
+            // A rate=N widget takes a new value in its next slot, the rest straight away
+            w.pending = w.spec.refresh == REFRESH_FIXED && w.refreshed >= 0 &&
+                        now_ < GridAfter(w.refreshed, w.period);
+            if (!w.pending) Bind(w, state);
+        }
+        Place(w);
+        Schedule(w);
+    }
+    return !damage_.Empty();
+}
+
+uint64_t DisplayRenderer::FrameKey() const {
+    uint64_t key = HashMix(0, (uint64_t)calibrations_ << 32 | (uint32_t)brightness_);
+    for (const Widget &w : widgets_) {
+        if (!w.drawn) {
+            key = HashMix(key, 0);
+            continue;
+        }
+        uint64_t content = 0;
+        switch (w.spec.kind) {
+        case W_ICON:     content = (uint64_t)w.value << 32 | (uint32_t)w.frame; break;
+        case W_BAR:      content = (uint32_t)w.value; break;
+        case W_TEXT:
+        case W_SCROLLER: content = w.strip.hash(); break;
+        }
+        key = HashMix(key, content);
+        key = HashMix(key, (uint64_t)(uint32_t)w.drawnX << 1 | w.stale);
+        key = HashMix(key, (uint64_t)(uint32_t)w.box.x0 << 32 | (uint32_t)w.box.y0);
+        key = HashMix(key, (uint64_t)(uint32_t)w.box.x1 << 32 | (uint32_t)w.box.y1);
+    }
+    return key;
+}
+
+void DisplayRenderer::SetCalibration(const ColorCalibration &cal) {
+    calibration_ = cal;
+    ++calibrations_;
+    lut_.Build(calibration_, brightness_);
+    DamageAll();
+}
+
+void DisplayRenderer::SetBrightness(int brightness) {
+    if (brightness == brightness_) return;
+    brightness_ = brightness;
+    lut_.Build(calibration_, brightness_);
+    DamageAll();
+}
+
+void DisplayRenderer::SetTiling(RenderPool *pool, int tile_width) {
+    pool_ = pool;
+    tile_width_ = tile_width;
+}
+
+void DisplayRenderer::Draw(Canvas *canvas) {
+    DamageList repaint = damage_;
+    repaint.Add(prevDamage_);
+    prevDamage_ = damage_;
+
+    const Rect all = MakeRect(0, 0, width_, height_);
+    if (!pool_ || pool_->threads() == 1 || tile_width_ <= 0 || tile_width_ >= width_ ||
+        repaint.Area() < PARALLEL_MIN_AREA) {
+        DrawRegion(canvas, repaint, all);
+        return;
+    }
+
+    // Widgets only read their retained state while drawing, so tiles can run concurrently
+    const int tiles = (width_ + tile_width_ - 1) / tile_width_;
+    auto drawTile = [&](int t) {
+        DrawRegion(canvas, repaint, Intersect(all, MakeRect(t * tile_width_, 0, tile_width_, height_)));
+    };
+    pool_->Run(tiles, drawTile);
+}
+
+// Clear each damaged region inside tile and redraw every widget that overlaps it, clipped to
+// the region
+void DisplayRenderer::DrawRegion(Canvas *canvas, const DamageList &repaint, const Rect &tile) const {
+    for (const Rect &damaged : repaint) {
+        const Rect r = Intersect(damaged, tile);
+        if (r.Empty()) continue;
+        ClipCanvas clip(canvas, r);
+        clip.Clear();
+        for (const Widget &w : widgets_) {
+            if (!w.drawn || !Overlaps(w.box, r)) continue;
+            const WidgetSpec &s = w.spec;
+            const rgb_matrix::Color color = w.stale ? Dim(s.color) : s.color;
+            switch (s.kind) {
+            case W_ICON:
+                BlitIcon(GetIconFrame((IconId)w.value, w.frame), &clip, s.x, s.y, w.stale ? BLIT_DIM : BLIT_OPAQUE,
+                         &lut_);
+                break;
+            case W_TEXT:
+                w.strip.Draw(canvas, r, s.x, s.y, color, 1, 0, &lut_);
+                break;
+            case W_SCROLLER:
+                // A scrolling line draws two back-to-back copies of the strip so the wrap is seamless
+                w.strip.Draw(canvas, Intersect(r, w.box), w.drawnX >> 8, s.y, color, Scrolls(w) ? 2 : 1,
+                             w.drawnX & (SUBPIXEL - 1), &lut_);
+                break;
+            case W_BAR: {
+                const rgb_matrix::Color c = lut_.Map(color);
+                FillRect(canvas, Intersect(r, MakeRect(s.x, s.y, w.value, s.h)), c.r, c.g, c.b);
+                break;
+            }
+            }
+        }
+    }
+}
@@ -0,0 +1,156 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <cstdint>
+#include <rpi-rgb-led-matrix/include/graphics.h>
+#include "shared_state.h"
+#include "damage.h"
+#include "text_strip.h"
+#include "text_metrics.h"
+#include "glyph_atlas.h"
+#include "layout.h"
+#include "render_pool.h"
+#include "color_lut.h"
+
+// Draws the weather + Spotify display into any rgb_matrix::Canvas, following a Layout.
+// Knows nothing about the matrix hardware, so the same code drives a FrameCanvas on the Pi
+// and a SoftwareCanvas on any Linux box.
+//
+// Per frame: Update() with the latest state works out the damage, then Draw() repaints only
+// the damaged regions into the canvas about to be shown. Canvases are assumed to be
+// double buffered like FrameCanvas, so each Draw() also repaints the previous frame's damage.
+//
+// Each widget is refreshed on its own schedule (rate= in the layout): on change, at a fixed
+// rate, or as fast as it animates. Periodic deadlines all fall on one grid of frame periods
+// counted from clock zero, so widgets at different rates share frames instead of each
+// waking the loop, and a frame only moves the widgets that are due.
+class DisplayRenderer {
+public:
+    // Built-in layout (DEFAULT_LAYOUT)
+    DisplayRenderer(const rgb_matrix::Font &font, int width, int height);
+    DisplayRenderer(const rgb_matrix::Font &font, int width, int height, Layout layout);
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+
+    // Frame period of the grid refresh deadlines are placed on, the --fps period.
+    // Animated scrollers move once per period.
+    void SetFramePeriod(int64_t period_ns);
+
+    // Move the widgets that are due at now_ns (monotonic): marquees to where they should be,
+    // icons to their current animation frame. Positions come from the clock and each
+    // scroller's speed, not from how many frames were drawn, so a slow or skipped frame
+    // doesn't slow the text down. Call before Update().
+    void Tick(int64_t now_ns);
+
+    // When the next widget is due (monotonic ns), or -1 if nothing moves or waits to be
+    // shown. A new value for a widget refreshed on change renders straight away instead.
+    int64_t NextDue() const;
+
+    // Repaint the whole panel on the next frames, e.g. after a brightness change
+    void DamageAll() { damage_all_ = true; }
+
+    // Color correction for everything drawn (see color_lut.h). The table is rebuilt and the
+    // panel repainted only when the calibration or brightness (library percent) changes.
+    void SetCalibration(const ColorCalibration &cal);
+    void SetBrightness(int brightness);
+
+    // Work out what changed since the last frame. Returns false if there's nothing to draw.
+    bool Update(const StateData &state);
+
+    // Repaint the damaged regions into canvas, the buffer about to be shown
+    void Draw(rgb_matrix::Canvas *canvas);
+
+    // Key of the frame the last Update() laid out: what each widget shows, where, and the
+    // brightness of the color table, folded into 64 bits. Frames with equal keys look the
+    // same, so a frame whose key matches the one on screen needn't be drawn or swapped in,
+    // and no pixels have to be read back to tell. Skipping Draw() for such a frame is safe:
+    // the damage it leaves undrawn changes nothing visible.
+    uint64_t FrameKey() const;
+
+    // Split large repaints into vertical tiles tile_width pixels wide, drawn in parallel on
+    // pool. Tiles split by column because the matrix packs pixels (x, y) and (x, y + rows/2)
+    // into the same framebuffer word, so two threads must never write the same column.
+    // Pass nullptr to draw on the calling thread only.
+    void SetTiling(RenderPool *pool, int tile_width);
+
+    const DamageList &damage() const { return damage_; }
+
+private:
+    // One entry of the draw list: the widget from the layout plus what it retains between
+    // frames. Text is rasterized into its strip only when the bound field's generation
+    // changes; every other frame just copies pixels out of the strip.
+    struct Widget {
+        WidgetSpec spec;
+        const rgb_matrix::Font *font = nullptr;
+        TextMeasurer *measure = nullptr;
+        GlyphAtlas *atlas = nullptr;
+        uint32_t gen = 0;      // generation of the bound field last seen
+        bool seen = false;     // false until the first Update
+        bool changed = true;   // content changed since it was last put on screen
+        bool stale = false;    // showing a value restored from the state cache, drawn dimmed
+
+        std::string text;      // text content
+        int value = 0;         // icon ID, or bar fill in pixels
+        TextStrip strip;       // text pre-rasterized once per change
+        int cycle = 0;         // scroller: text width if it fits, else text width + GAP
+        int pos = 0;           // scroller: offset of the text from the widget's left edge, 1/256 px
+        int64_t scrollStart = 0; // scroller: when the text started moving in from the right edge
+        int frame = 0;         // icon: animation frame on screen
+        int64_t animStart = 0; // icon: when the current icon appeared, frames count from here
+        int64_t frameDue = -1; // icon: when the frame changes next, -1 for a static icon
+
+        // Refresh schedule
+        int64_t period = 0;    // rate=N or an animated scroller: frame-grid period, else 0
+        int64_t refreshed = -1; // when it was last moved or redrawn
+        int64_t due = -1;      // when it next needs a frame, -1 for none
+        bool pending = false;  // rate=N: a new value is waiting for the next slot
+
+        // What it last put on screen and where. If the content or position changes, both the
+        // old and the new box are damaged so only that part of the panel gets redrawn.
+        int drawnX = 0;        // 1/256 px
+        Rect box;
+        bool drawn = false;
+    };
+
+    bool Scrolls(const Widget &w) const { return w.spec.kind == W_SCROLLER && w.cycle > w.spec.w; }
+    // Content that changes over time, unless the widget is only redrawn on change
+    bool Moves(const Widget &w) const {
+        if (w.spec.refresh == REFRESH_CHANGE) return false;
+        return Scrolls(w) || (w.spec.kind == W_ICON && w.frameDue >= 0);
+    }
+    void Bind(Widget &w, const StateData &state);
+    void Place(Widget &w);
+    void Schedule(Widget &w);
+    struct FontCache {
+        const rgb_matrix::Font *font;
+        std::unique_ptr<TextMeasurer> measure; // UTF-8 aware, caches glyph and string widths
+        std::unique_ptr<GlyphAtlas> atlas;     // glyphs as runs, for rasterizing strips
+    };
+    FontCache &CacheFor(const rgb_matrix::Font *font);
+    void DrawRegion(rgb_matrix::Canvas *canvas, const DamageList &repaint, const Rect &tile) const;
+
+    const rgb_matrix::Font &font_;
+    const int width_;
+    const int height_;
+
+    Layout layout_;                 // owns any fonts the widgets refer to
+    std::vector<Widget> widgets_;   // flat draw list, in draw order
+    std::vector<FontCache> fonts_; // one per font in use
+
+    DamageList damage_;     // this frame
+    DamageList prevDamage_; // last frame, still stale in the other buffer
+    bool damage_all_ = true;
+    int64_t now_ = 0; // time of the last Tick
+    int64_t frame_period_ = 1000000000LL / 60;
+
+    ColorCalibration calibration_;
+    int brightness_ = 100;
+    ColorLut lut_; // read by every tile while drawing, only rebuilt between frames
+    uint32_t calibrations_ = 0; // SetCalibration calls, part of FrameKey
+
+    RenderPool *pool_ = nullptr;
+    int tile_width_ = 0;
+};
@@ -1,32 +1,232 @@
 #pragma once
+#include <algorithm>
 #include <string>
+#include <string_view>
 #include <mutex>
+#include <atomic>
+#include <cstdint>
+#include "icons_weather.h"
+#include "render_scheduler.h"
+#include "frame_telemetry.h"
 
-struct SharedState {
+// Fields published by MQTT. Each one carries a generation counter that only bumps when
+// the value actually changes, so the render loop copies a string only when it is new.
+enum StateField {
+    F_WEATHER_COND,
+    F_WEATHER_TEMP,
+    F_WEATHER_SUMMARY,
+    F_TRACK,
+    F_ARTIST,
+    F_BRIGHTNESS,
+    F_COUNT
+};
+
+constexpr uint32_t FieldBit(StateField f) { return 1u << f; }
+
+// Brightness accepted from MQTT and the state cache, in percent. Below 5 the panel is dark
+// enough to look broken.
+constexpr int BRIGHTNESS_MIN = 5;
+constexpr int BRIGHTNESS_MAX = 100;
+
+struct StateData {
     std::string weatherCond;
+    IconId weatherIcon = ICON_UNKNOWN; // resolved from weatherCond when it arrives
     std::string weatherTemp;
     std::string weatherSummary;
     std::string track;
     std::string artist;
-    int brightness = 50; // 0 to 100
-    bool dirty = true; // set when something changed
-    std::mutex m;
+    int brightness = 50; // BRIGHTNESS_MIN to BRIGHTNESS_MAX
+    uint32_t gen[F_COUNT] = {}; // per-field generation
+    uint32_t version = 0;       // bumped on every publish
+    int64_t changedNs = 0;      // when the oldest change the reader hasn't picked up was published (telemetry)
+    uint32_t stale = 0;         // FieldBit mask of values restored from the state cache, not yet sent by MQTT
+};
+
+// Member pointer for each string field, indexed by StateField (brightness has none)
+static constexpr std::string StateData::*kStringFields[F_COUNT] = {
+    &StateData::weatherCond, &StateData::weatherTemp, &StateData::weatherSummary,
+    &StateData::track, &StateData::artist, nullptr
 };
 
-// Lock to snapshot so render loop can use local copy.
-inline void SnapshotState(SharedState &src, SharedState &dest) {
-    std::lock_guard<std::mutex> lk(src.m);
-    dest.weatherCond = src.weatherCond;
-    dest.weatherTemp = src.weatherTemp;
-    dest.weatherSummary = src.weatherSummary;
-    dest.track = src.track;
-    dest.artist = src.artist;
+// Copy fields whose generation differs from dest. Returns true if anything was copied.
+inline bool CopyChangedFields(const StateData &src, StateData &dest) {
+    if (src.version == dest.version) return false;
+    for (int f = 0; f < F_COUNT; ++f) {
+        if (src.gen[f] == dest.gen[f]) continue;
+        if (kStringFields[f]) dest.*kStringFields[f] = src.*kStringFields[f];
+        dest.gen[f] = src.gen[f];
+    }
+    dest.weatherIcon = src.weatherIcon;
     dest.brightness = src.brightness;
-    dest.dirty = src.dirty;
+    dest.version = src.version;
+    dest.changedNs = src.changedNs;
+    dest.stale = src.stale;
+    return true;
 }
 
-// Mark dirty when external update occurs.
-inline void MarkDirty(SharedState &st) {
-    std::lock_guard<std::mutex> lk(st.m);
-    st.dirty = true;
-}
+// State shared between the mosquitto thread (writer) and the render loop (reader).
+// Triple buffered: the writer fills a back slot and atomically exchanges it with the middle
+// slot, the reader exchanges its front slot with the middle one when it is marked fresh.
+// Each slot is owned by exactly one side at a time, so the reader never blocks or waits
+// on a writer, and never sees a half-written string.
+//
+// Fields can also be grouped (track + artist) so that related messages are committed
+// together: a grouped value is held back until every field in the group has arrived or the
+// coalescing window runs out, then published as one change. The render loop sees one
+// snapshot, lays out once and resets each marquee once, instead of drawing a frame with the
+// new track and the old artist.
+class SharedState {
+public:
+    SharedState() {
+        // Start at version 1 so the first snapshot always renders
+        for (StateData &s : slots_) s.version = 1;
+        pending_.version = 1;
+    }
+
+    // Group string fields (a mask of FieldBit) with a coalescing window. A window of 0
+    // turns grouping off. Call before any writers start.
+    void SetCoalescing(uint32_t fields, int64_t window_ns) {
+        std::lock_guard<std::mutex> lk(writer_m_);
+        CommitLocked();
+        group_  = window_ns > 0 ? fields : 0;
+        window_ = window_ns;
+    }
+
+    // Writer side. Writers serialize on a mutex the render loop never touches.
+    // Returns true if the value changed (and was published). Takes a view so MQTT payloads
+    // go straight in; the strings keep their capacity, so repeat updates don't allocate.
+    // A grouped field returns true if the value differs from what is on screen, so the caller
+    // still wakes the render loop to pick up the commit deadline.
+    // A value restored from the cache counts as changed the first time MQTT sends it, even if
+    // it's the same, so it stops being marked stale.
+    bool Set(StateField f, std::string_view value) {
+        std::lock_guard<std::mutex> lk(writer_m_);
+        if (group_ & FieldBit(f)) return HoldLocked(f, value);
+        std::string &dst = pending_.*kStringFields[f];
+        if (dst == value && !(pending_.stale & FieldBit(f))) return false;
+        dst.assign(value.data(), value.size());
+        pending_.stale &= ~FieldBit(f);
+        ++pending_.gen[f];
+        PublishLocked();
+        return true;
+    }
+
+    // Condition text and its icon change together, under the F_WEATHER_COND generation
+    bool SetWeatherCond(std::string_view cond, IconId icon) {
+        std::lock_guard<std::mutex> lk(writer_m_);
+        if (pending_.weatherCond == cond && pending_.weatherIcon == icon &&
+            !(pending_.stale & FieldBit(F_WEATHER_COND))) return false;
+        pending_.weatherCond.assign(cond.data(), cond.size());
+        pending_.weatherIcon = icon;
+        pending_.stale &= ~FieldBit(F_WEATHER_COND);
+        ++pending_.gen[F_WEATHER_COND];
+        PublishLocked();
+        return true;
+    }
+
+    // Start from the last known state (see state_cache.h) before MQTT is connected. Non-empty
+    // strings are published marked stale until MQTT sends them; brightness is a setting and
+    // is just taken, clamped to the range MQTT may set. Call before any writers start.
+    void Restore(const StateData &cached) {
+        std::lock_guard<std::mutex> lk(writer_m_);
+        for (int f = 0; f < F_COUNT; ++f) {
+            if (!kStringFields[f] || (cached.*kStringFields[f]).empty()) continue;
+            pending_.*kStringFields[f] = cached.*kStringFields[f];
+            pending_.stale |= FieldBit((StateField)f);
+            ++pending_.gen[f];
+        }
+        pending_.weatherIcon = cached.weatherIcon;
+        const int b = std::clamp(cached.brightness, BRIGHTNESS_MIN, BRIGHTNESS_MAX);
+        if (b != pending_.brightness) {
+            pending_.brightness = b;
+            ++pending_.gen[F_BRIGHTNESS];
+        }
+        PublishLocked();
+    }
+
+    bool SetBrightness(int b) {
+        std::lock_guard<std::mutex> lk(writer_m_);
+        if (pending_.brightness == b) return false;
+        pending_.brightness = b;
+        ++pending_.gen[F_BRIGHTNESS];
+        PublishLocked();
+        return true;
+    }
+
+    // Deadline for the held group, or -1 if nothing is held. Render thread, lock-free.
+    int64_t commit_deadline() const { return commit_deadline_.load(std::memory_order_acquire); }
+
+    // Publish a held group whose window has run out. Render thread; only takes the writer
+    // lock when a group actually timed out. Returns true if anything was published.
+    bool CommitExpired(int64_t now) {
+        const int64_t d = commit_deadline();
+        if (d < 0 || now < d) return false;
+        std::lock_guard<std::mutex> lk(writer_m_);
+        return CommitLocked();
+    }
+
+    // Reader side, render thread only. Wait-free: one atomic load, at most one exchange.
+    // Returns true if anything changed since dest was last filled.
+    bool Snapshot(StateData &dest) {
+        if (middle_.load(std::memory_order_relaxed) & FRESH) {
+            front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX_MASK;
+        }
+        return CopyChangedFields(slots_[front_], dest);
+    }
+
+private:
+    static constexpr uint8_t INDEX_MASK = 0x3;
+    static constexpr uint8_t FRESH = 0x4;
+
+    void PublishLocked() {
+        ++pending_.version;
+        // Keep the earlier timestamp while the previous publish is still waiting for the reader,
+        // so latency is measured from the first change a frame shows. If the reader takes it
+        // between this check and the exchange, one sample reads slightly long.
+        if (!(middle_.load(std::memory_order_relaxed) & FRESH)) pending_.changedNs = TelemetryNow();
+        CopyChangedFields(pending_, slots_[back_]);
+        back_ = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    bool HoldLocked(StateField f, std::string_view value) {
+        const bool changed = (pending_.*kStringFields[f]) != value || (pending_.stale & FieldBit(f));
+        if (!held_mask_) commit_deadline_.store(NowNs() + window_, std::memory_order_release);
+        held_[f].assign(value.data(), value.size());
+        held_mask_ |= FieldBit(f);
+        if (held_mask_ == group_) return CommitLocked();
+        return changed;
+    }
+
+    // Move held values into pending_ and publish them in one go, if any differ
+    bool CommitLocked() {
+        bool any = false;
+        for (int f = 0; f < F_COUNT; ++f) {
+            if (!(held_mask_ & FieldBit((StateField)f))) continue;
+            std::string &dst = pending_.*kStringFields[f];
+            if (dst == held_[f] && !(pending_.stale & FieldBit((StateField)f))) continue;
+            dst.swap(held_[f]); // keeps both buffers, so nothing is allocated next time
+            pending_.stale &= ~FieldBit((StateField)f);
+            ++pending_.gen[f];
+            any = true;
+        }
+        held_mask_ = 0;
+        commit_deadline_.store(-1, std::memory_order_release);
+        if (any) PublishLocked();
+        return any;
+    }
+
+    StateData slots_[3];
+    std::atomic<uint8_t> middle_{1};
+    uint8_t front_ = 0; // reader owned
+    uint8_t back_ = 2;  // writer owned, guarded by writer_m_
+
+    StateData pending_; // authoritative copy, guarded by writer_m_
+
+    // Coalescing group, guarded by writer_m_
+    uint32_t group_ = 0;
+    int64_t window_ = 0;
+    uint32_t held_mask_ = 0;
+    std::string held_[F_COUNT];
+    std::atomic<int64_t> commit_deadline_{-1};
+    std::mutex writer_m_;
+};
@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// Shared-memory frame ring between a local producer process and the display (--shm=NAME).
+//
+// The display creates the segment (/dev/shm/NAME) sized for its canvas and fills in the
+// header; producers map it, check magic/version and read the geometry from it. Frames are
+// packed RGB888 rows, width * height * 3 bytes, in SHM_SLOTS slots after the header.
+//
+// Handshake, per frame n = 1, 2, ... written into slot n % SHM_SLOTS:
+//   producer: slot.seq = 2n + 1 (odd: being written), write pixels and stamp_ns,
+//             slot.seq = 2n (release), then latest = n (release)
+//   display:  n = latest, check slot.seq == 2n, copy the pixels, check slot.seq again.
+//             If it moved, the producer lapped the ring mid-copy and the frame is dropped.
+// Neither side ever waits for the other. With three slots the producer has to write two
+// whole frames during one copy to tear it.
+//
+// Only 32-bit atomics are used so they are lock-free (and so valid across processes) on
+// every Pi. Sequence numbers wrap after 2^31 frames, compared for equality only.
+
+constexpr uint32_t SHM_MAGIC   = 0x4d52464d; // "MFRM"
+constexpr uint32_t SHM_VERSION = 1;
+constexpr int SHM_SLOTS        = 3;
+
+struct ShmSlot {
+    std::atomic<uint32_t> seq;
+    uint32_t reserved;
+    int64_t stamp_ns; // producer's CLOCK_MONOTONIC when the frame was finished
+};
+
+struct ShmFrameHeader {
+    uint32_t magic;       // written last by the display, once the rest is valid
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t frame_bytes; // width * height * 3
+    std::atomic<uint32_t> latest;           // newest complete frame, 0 = none yet
+    std::atomic<uint32_t> shown_seq;        // newest frame the display has put on the panel
+    std::atomic<uint32_t> shown_latency_us; // stamp_ns to the end of its SwapOnVSync
+    ShmSlot slot[SHM_SLOTS];
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shm handshake needs lock-free 32-bit atomics");
+
+// Frames start on a cache line after the header
+constexpr size_t ShmFrameOffset(int slot, size_t frame_bytes) {
+    return ((sizeof(ShmFrameHeader) + 63) & ~(size_t)63) + (size_t)slot * frame_bytes;
+}
+
+constexpr size_t ShmSegmentSize(size_t frame_bytes) {
+    return ShmFrameOffset(SHM_SLOTS, frame_bytes);
+}
@@ -0,0 +1,150 @@
+// Example producer for the display's shared-memory input mode (--shm=NAME, see shm_frames.h).
+// Writes an animated test pattern into the ring at a fixed rate and reports the frame rate it
+// achieved and the latency the display reports back, from finishing a frame here to the end
+// of the SwapOnVSync that put it on the panel.
+//
+// Build:  g++ -O2 -std=c++17 -I. shm_producer.cpp -o shm-producer -lrt
+// Run:    sudo ./matrix-display --shm=matrix &  ./shm-producer matrix --cols=64 --rows=32 --fps=60
+//
+// --cols and --rows are the display's whole canvas (all chained panels). A segment laid out
+// for any other size is refused rather than written with the wrong stride.
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "shm_frames.h"
+#include "frame_stats.h"
+
+static int64_t NowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void SleepUntil(int64_t t) {
+    struct timespec ts = { (time_t)(t / 1000000000LL), (long)(t % 1000000000LL) };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+}
+
+// Map the display's segment, waiting up to a few seconds for it to be created. The header is
+// only trusted if it describes exactly the cols x rows frames this producer writes.
+static ShmFrameHeader *MapSegment(const std::string &path, int cols, int rows) {
+    const size_t frame_bytes = (size_t)cols * rows * 3;
+    bool reported = false;
+    for (int attempt = 0; attempt < 50; ++attempt, usleep(100000)) {
+        const int fd = shm_open(path.c_str(), O_RDWR, 0);
+        if (fd < 0) continue;
+        struct stat st;
+        if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(ShmFrameHeader)) {
+            close(fd);
+            continue;
+        }
+        void *p = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) return nullptr;
+        ShmFrameHeader *h = static_cast<ShmFrameHeader *>(p);
+        if (h->magic == SHM_MAGIC && h->version == SHM_VERSION) {
+            const uint32_t sw = h->width, sh = h->height, sb = h->frame_bytes;
+            if (sw == (uint32_t)cols && sh == (uint32_t)rows && sb == frame_bytes &&
+                (size_t)st.st_size >= ShmSegmentSize(frame_bytes)) return h;
+            // Keep waiting, the display may be restarting with the new size
+            if (!reported) {
+                fprintf(stderr, "Segment %s is %ux%u (%u bytes a frame), not %dx%d; waiting\n",
+                        path.c_str(), sw, sh, sb, cols, rows);
+                reported = true;
+            }
+        }
+        munmap(p, st.st_size);
+    }
+    return nullptr;
+}
+
+// Diagonal rainbow sweep with a white column running across, so tearing or dropped
+// frames are easy to spot on the panel
+static void DrawPattern(uint8_t *dst, int w, int h, uint32_t n) {
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x, dst += 3) {
+            const int v = (x + y + (int)n) & 255;
+            dst[0] = v;
+            dst[1] = 255 - v;
+            dst[2] = (v * 2) & 255;
+            if (x == (int)(n % w)) dst[0] = dst[1] = dst[2] = 255;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s NAME [--cols=N] [--rows=N] [--fps=N] [--seconds=N]\n", argv[0]);
+        return 1;
+    }
+    const std::string name = argv[1];
+    int cols = 64, rows = 32, fps = 60, seconds = 10;
+    for (int i = 2; i < argc; ++i) {
+        if (!strncmp(argv[i], "--cols=", 7)) cols = atoi(argv[i] + 7);
+        else if (!strncmp(argv[i], "--rows=", 7)) rows = atoi(argv[i] + 7);
+        else if (!strncmp(argv[i], "--fps=", 6)) fps = atoi(argv[i] + 6);
+        else if (!strncmp(argv[i], "--seconds=", 10)) seconds = atoi(argv[i] + 10);
+    }
+    if (cols <= 0 || rows <= 0 || fps <= 0 || seconds <= 0) return 1;
+
+    ShmFrameHeader *h = MapSegment(name[0] == '/' ? name : "/" + name, cols, rows);
+    if (!h) {
+        fprintf(stderr, "No %dx%d display segment %s, start the display with --shm=%s first\n",
+                cols, rows, name.c_str(), name.c_str());
+        return 1;
+    }
+    // Geometry from here on is our own, never re-read from the shared header
+    const int w = cols, ht = rows;
+    const size_t frame_bytes = (size_t)w * ht * 3;
+    uint8_t *frames = reinterpret_cast<uint8_t *>(h) + ShmFrameOffset(0, frame_bytes);
+    printf("%dx%d, %d slots, target %d fps\n", w, ht, SHM_SLOTS, fps);
+
+    LatencyHistogram latency, frameTime;
+    const int64_t period = 1000000000LL / fps;
+    const int64_t start = NowNs();
+    uint32_t n = h->latest.load(std::memory_order_relaxed); // carry on after a previous producer
+    uint32_t lastShown = h->shown_seq.load(std::memory_order_relaxed);
+    const uint32_t first = n;
+    uint32_t shownCount = 0;
+
+    for (int64_t next = start; next < start + seconds * 1000000000LL; next += period) {
+        SleepUntil(next);
+        const int64_t t0 = NowNs();
+
+        ++n;
+        if (n == 0) n = 1; // 0 means "no frame"
+        ShmSlot &slot = h->slot[n % SHM_SLOTS];
+        slot.seq.store(n * 2 + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        DrawPattern(frames + (size_t)(n % SHM_SLOTS) * frame_bytes, w, ht, n);
+        slot.stamp_ns = NowNs();
+        slot.seq.store(n * 2, std::memory_order_release);
+        h->latest.store(n, std::memory_order_release);
+        frameTime.Record(NowNs() - t0);
+
+        const uint32_t shown = h->shown_seq.load(std::memory_order_acquire);
+        if (shown != lastShown) {
+            latency.Record((int64_t)h->shown_latency_us.load(std::memory_order_relaxed) * 1000);
+            lastShown = shown;
+            ++shownCount;
+        }
+    }
+
+    const double elapsed = (NowNs() - start) / 1e9;
+    printf("wrote %u frames in %.1f s: %.1f fps, %.1f fps shown\n", n - first, elapsed,
+           (n - first) / elapsed, shownCount / elapsed);
+    printf("write   (us): mean %.0f p50 %lld p99 %lld max %lld\n", frameTime.mean() / 1000,
+           (long long)frameTime.Percentile(50) / 1000, (long long)frameTime.Percentile(99) / 1000,
+           (long long)frameTime.max() / 1000);
+    printf("latency (us): mean %.0f p50 %lld p99 %lld max %lld\n", latency.mean() / 1000,
+           (long long)latency.Percentile(50) / 1000, (long long)latency.Percentile(99) / 1000,
+           (long long)latency.max() / 1000);
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "shm_source.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include "software_canvas.h"
+#include "frame_hash.h"
+
+ShmFrameSource::~ShmFrameSource() {
+    if (header_) munmap(header_, size_);
+}
+
+bool ShmFrameSource::Open(const std::string &name, int width, int height) {
+    const std::string path = name[0] == '/' ? name : "/" + name;
+    // Whatever is written here goes straight onto the panel, so only our own user gets to
+    // write it. A segment someone else created first is refused, and one left over from an
+    // older run with looser permissions is tightened.
+    const int fd = shm_open(path.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0) return false;
+
+    const size_t frame_bytes = (size_t)width * height * 3;
+    const size_t size = ShmSegmentSize(frame_bytes);
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return false;
+    }
+    if (st.st_uid != geteuid()) {
+        close(fd);
+        errno = EPERM;
+        return false;
+    }
+    if (((st.st_mode & 0777) != 0600 && fchmod(fd, 0600) < 0) ||
+        ((size_t)st.st_size != size && ftruncate(fd, size) < 0)) {
+        close(fd);
+        return false;
+    }
+    void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return false;
+
+    header_ = static_cast<ShmFrameHeader *>(p);
+    frames_ = static_cast<const uint8_t *>(p) + ShmFrameOffset(0, frame_bytes);
+    size_   = size;
+    frame_bytes_ = frame_bytes;
+    width_  = width;
+    height_ = height;
+
+    // Keep a segment left over from a previous run if it matches, so a running producer
+    // carries on; otherwise start it over. magic goes in last so producers never see a
+    // half-initialized header.
+    ShmFrameHeader *h = header_;
+    if (h->magic != SHM_MAGIC || h->version != SHM_VERSION || h->width != (uint32_t)width ||
+        h->height != (uint32_t)height || h->frame_bytes != frame_bytes) {
+        h->magic = 0;
+        std::atomic_thread_fence(std::memory_order_release);
+        memset((void *)h, 0, size);
+        h->version     = SHM_VERSION;
+        h->width       = width;
+        h->height      = height;
+        h->frame_bytes = frame_bytes;
+        std::atomic_thread_fence(std::memory_order_release);
+        h->magic       = SHM_MAGIC;
+    }
+    return true;
+}
+
+bool ShmFrameSource::CopyLatest(rgb_matrix::Canvas *canvas) {
+    const uint32_t n = header_->latest.load(std::memory_order_acquire);
+    if (n == 0 || n == copied_) return false;
+
+    ShmSlot &slot = header_->slot[n % SHM_SLOTS];
+    const uint32_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq != n * 2) return false; // already being overwritten by a newer frame
+
+    const uint8_t *src = frames_ + (size_t)(n % SHM_SLOTS) * frame_bytes_;
+    const int w = std::min(width_, canvas->width()), h = std::min(height_, canvas->height());
+    SoftwareCanvas *sw = dynamic_cast<SoftwareCanvas *>(canvas);
+    for (int y = 0; y < h; ++y) {
+        const uint8_t *row = src + (size_t)y * width_ * 3;
+        if (sw) {
+            memcpy(sw->Row(y), row, (size_t)w * 3);
+            continue;
+        }
+        for (int x = 0; x < w; ++x, row += 3) canvas->SetPixel(x, y, row[0], row[1], row[2]);
+    }
+    const int64_t stamp = slot.stamp_ns;
+    const uint64_t hash = HashFrame(src, frame_bytes_);
+
+    // Seqlock check: if the slot changed while we copied or hashed, the frame may be torn
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) != seq) return false;
+    copied_ = n;
+    stamp_ns_ = stamp;
+    hash_ = hash;
+    return true;
+}
+
+void ShmFrameSource::Shown(int64_t now_ns) {
+    const int64_t us = (now_ns - stamp_ns_) / 1000;
+    header_->shown_latency_us.store(us < 0 ? 0 : us > UINT32_MAX ? UINT32_MAX : (uint32_t)us,
+                                    std::memory_order_relaxed);
+    header_->shown_seq.store(copied_, std::memory_order_release);
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <rpi-rgb-led-matrix/include/canvas.h>
+#include "shm_frames.h"
+
+// Display side of the shared-memory frame ring (see shm_frames.h).
+// Creates or reuses /dev/shm/NAME for a width x height canvas and copies the newest complete
+// frame into the canvas about to be swapped. Nothing is allocated after Open().
+class ShmFrameSource {
+public:
+    ShmFrameSource() = default;
+    ~ShmFrameSource();
+    ShmFrameSource(const ShmFrameSource &) = delete;
+    ShmFrameSource &operator=(const ShmFrameSource &) = delete;
+
+    // Map the segment, creating or resizing it as needed, readable and writable by our own
+    // user only. Returns false with errno set on failure, EPERM if another user owns it.
+    bool Open(const std::string &name, int width, int height);
+
+    // Copy the newest complete frame into canvas if there is one we haven't copied yet.
+    // Returns false if there's nothing new or the frame was overwritten mid-copy, in which
+    // case canvas may be partly written and must not be shown.
+    bool CopyLatest(rgb_matrix::Canvas *canvas);
+
+    // Producer timestamp of the frame last copied
+    int64_t stamp_ns() const { return stamp_ns_; }
+
+    // Hash of the RGB frame last copied, as the producer wrote it (see frame_hash.h)
+    uint64_t hash() const { return hash_; }
+
+    // The copied frame is on the panel. Reports it back to the producer.
+    void Shown(int64_t now_ns);
+
+    // Copy the current frame again on the next call, e.g. after a brightness change
+    void Invalidate() { copied_ = 0; }
+
+private:
+    ShmFrameHeader *header_ = nullptr;
+    const uint8_t *frames_ = nullptr;
+    size_t size_ = 0;
+    size_t frame_bytes_ = 0; // slot stride, fixed at Open; the header's copy is never read back
+    int width_ = 0, height_ = 0;
+    uint32_t copied_ = 0;   // sequence number of the frame last copied
+    int64_t stamp_ns_ = 0;
+    uint64_t hash_ = 0;
+};
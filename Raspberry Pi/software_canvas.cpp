@@ -0,0 +1,25 @@
+#include "software_canvas.h"
+#include <cstring>
+
+SoftwareCanvas::SoftwareCanvas(int width, int height)
+    : width_(width > 0 ? width : 0),
+      height_(height > 0 ? height : 0),
+      pixels_((size_t)width_ * height_ * 3, 0) {}
+
+void SoftwareCanvas::Clear() {
+    memset(pixels_.data(), 0, pixels_.size());
+}
+
+void SoftwareCanvas::Fill(uint8_t red, uint8_t green, uint8_t blue) {
+    if (pixels_.empty()) return;
+    if (red == green && green == blue) {
+        memset(pixels_.data(), red, pixels_.size());
+        return;
+    }
+    // Fill the first row, then copy it down
+    uint8_t *row0 = Row(0);
+    for (int x = 0; x < width_; ++x) {
+        row0[x * 3] = red; row0[x * 3 + 1] = green; row0[x * 3 + 2] = blue;
+    }
+    for (int y = 1; y < height_; ++y) memcpy(Row(y), row0, stride());
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "canvas.h"
+
+// In-memory canvas with a packed RGB888 framebuffer (3 bytes per pixel, rows back to back).
+// Drawing code that knows about it can write whole rows directly instead of going
+// through the virtual SetPixel once per pixel.
+class SoftwareCanvas : public rgb_matrix::Canvas {
+public:
+    SoftwareCanvas(int width, int height);
+
+    int width() const override { return width_; }
+    int height() const override { return height_; }
+
+    void SetPixel(int x, int y, uint8_t red, uint8_t green, uint8_t blue) override {
+        if (x < 0 || x >= width_ || y < 0 || y >= height_) return;
+        uint8_t *p = &pixels_[(size_t)y * stride() + x * 3];
+        p[0] = red; p[1] = green; p[2] = blue;
+    }
+    void Clear() override;
+    void Fill(uint8_t red, uint8_t green, uint8_t blue) override;
+
+    // Bytes per row
+    int stride() const { return width_ * 3; }
+
+    // Start of row y, no bounds check
+    uint8_t *Row(int y) { return &pixels_[(size_t)y * stride()]; }
+    const uint8_t *Row(int y) const { return &pixels_[(size_t)y * stride()]; }
+
+    // Set len pixels of row y starting at x, no bounds check
+    void FillSpan(int x, int y, int len, uint8_t red, uint8_t green, uint8_t blue) {
+        uint8_t *p = Row(y) + x * 3;
+        for (int i = 0; i < len; ++i, p += 3) { p[0] = red; p[1] = green; p[2] = blue; }
+    }
+
+    const uint8_t *data() const { return pixels_.data(); }
+    size_t size() const { return pixels_.size(); }
+
+private:
+    int width_;
+    int height_;
+    std::vector<uint8_t> pixels_;
+};
@@ -0,0 +1,110 @@
+#include "state_cache.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr uint32_t CACHE_MAGIC = 0x4358534d; // "MSXC"
+constexpr uint16_t CACHE_VERSION = 1;
+
+struct CacheHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t fields;   // string fields that follow, F_COUNT - 1 when written
+    uint32_t length;   // bytes after the header
+    uint32_t checksum; // FNV-1a of those bytes
+};
+
+// FNV-1a over the record body
+uint32_t Checksum(const uint8_t *p, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; ++i) h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+}
+
+StateCache::~StateCache() {
+    if (data_) munmap(data_, FILE_SIZE);
+}
+
+bool StateCache::Open(const char *path) {
+    const int fd = open(path, O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || ((size_t)st.st_size != FILE_SIZE && ftruncate(fd, FILE_SIZE) < 0)) {
+        close(fd);
+        return false;
+    }
+    void *p = mmap(nullptr, FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return false;
+    data_ = static_cast<uint8_t *>(p);
+    return true;
+}
+
+bool StateCache::Load(StateData &out) const {
+    if (!data_) return false;
+    CacheHeader h;
+    memcpy(&h, data_, sizeof(h));
+    if (h.magic != CACHE_MAGIC || h.version != CACHE_VERSION || h.fields != F_COUNT - 1 ||
+        h.length > FILE_SIZE - sizeof(h)) return false;
+    const uint8_t *p = data_ + sizeof(h), *end = p + h.length;
+    if (Checksum(p, h.length) != h.checksum) return false;
+
+    StateData s;
+    int32_t brightness;
+    memcpy(&brightness, p, sizeof(brightness));
+    p += sizeof(brightness);
+    // Checksummed, but written by an older build or by hand it could still be anything;
+    // out of range keeps the default rather than restoring a dark or overdriven panel
+    if (brightness >= BRIGHTNESS_MIN && brightness <= BRIGHTNESS_MAX) s.brightness = brightness;
+    for (int f = 0; f < F_COUNT; ++f) {
+        if (!kStringFields[f]) continue;
+        uint16_t len;
+        if (end - p < (ptrdiff_t)sizeof(len)) return false;
+        memcpy(&len, p, sizeof(len));
+        p += sizeof(len);
+        if (end - p < len) return false;
+        (s.*kStringFields[f]).assign(reinterpret_cast<const char *>(p), len);
+        p += len;
+    }
+    s.weatherIcon = ResolveWeatherIcon(s.weatherCond);
+    out = std::move(s);
+    return true;
+}
+
+void StateCache::Save(const StateData &state) {
+    if (!data_) return;
+    if (saved_ && std::equal(saved_gen_, saved_gen_ + F_COUNT, state.gen)) return;
+
+    // Build the record on the stack and copy it over the old one in one go
+    uint8_t buf[FILE_SIZE];
+    uint8_t *p = buf + sizeof(CacheHeader);
+    const int32_t brightness = state.brightness;
+    memcpy(p, &brightness, sizeof(brightness));
+    p += sizeof(brightness);
+    for (int f = 0; f < F_COUNT; ++f) {
+        if (!kStringFields[f]) continue;
+        const std::string &v = state.*kStringFields[f];
+        const uint16_t len = (uint16_t)std::min(v.size(), FIELD_MAX);
+        memcpy(p, &len, sizeof(len));
+        memcpy(p + sizeof(len), v.data(), len);
+        p += sizeof(len) + len;
+    }
+    CacheHeader h;
+    h.magic    = CACHE_MAGIC;
+    h.version  = CACHE_VERSION;
+    h.fields   = F_COUNT - 1;
+    h.length   = (uint32_t)(p - buf - sizeof(h));
+    h.checksum = Checksum(buf + sizeof(h), h.length);
+    memcpy(buf, &h, sizeof(h));
+    memcpy(data_, buf, p - buf);
+
+    std::copy(state.gen, state.gen + F_COUNT, saved_gen_);
+    saved_ = true;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include "shared_state.h"
+
+// Last known display state, kept in a small memory-mapped file so a restart can show it
+// straight away instead of a blank panel while MQTT connects.
+//
+// The file is one fixed-size record: a header with a checksum, then the string fields and
+// brightness. Save() rewrites it in place through the mapping, which is just a memcpy into
+// the page cache; the kernel writes it back in its own time. A torn or foreign file fails the
+// checksum on the next Load() and is ignored, so the worst case is starting empty.
+// Render thread only after Open().
+class StateCache {
+public:
+    StateCache() = default;
+    ~StateCache();
+    StateCache(const StateCache &) = delete;
+    StateCache &operator=(const StateCache &) = delete;
+
+    // Map the file, creating it if needed. Returns false with errno set on failure.
+    bool Open(const char *path);
+    bool ok() const { return data_ != nullptr; }
+
+    // Fill out from the file. Returns false if there's no valid record. The icon is resolved
+    // again from the condition text, so a cache from an older build can't carry stale IDs.
+    bool Load(StateData &out) const;
+
+    // Store state if it differs from what was last saved
+    void Save(const StateData &state);
+
+    // Each string field is cut to this many bytes so a record always fits the file
+    static constexpr size_t FIELD_MAX = 600;
+    static constexpr size_t FILE_SIZE = 4096;
+
+private:
+    uint8_t *data_ = nullptr;
+    uint32_t saved_gen_[F_COUNT] = {}; // generations last written
+    bool saved_ = false;
+};
@@ -0,0 +1,79 @@
+#include "text_metrics.h"
+#include <algorithm>
+
+static constexpr uint32_t REPLACEMENT_CHAR = 0xFFFD;
+
+uint32_t NextCodepoint(const char *&p, const char *end) {
+    const uint8_t c = (uint8_t)*p++;
+    if (c < 0x80) return c;
+
+    int extra;
+    uint32_t cp, min;
+    if ((c & 0xE0) == 0xC0)      { extra = 1; cp = c & 0x1F; min = 0x80; }
+    else if ((c & 0xF0) == 0xE0) { extra = 2; cp = c & 0x0F; min = 0x800; }
+    else if ((c & 0xF8) == 0xF0) { extra = 3; cp = c & 0x07; min = 0x10000; }
+    else return REPLACEMENT_CHAR; // stray continuation byte or invalid lead
+
+    if (end - p < extra) return REPLACEMENT_CHAR;
+    for (int i = 0; i < extra; ++i) {
+        if (((uint8_t)p[i] & 0xC0) != 0x80) return REPLACEMENT_CHAR;
+        cp = (cp << 6) | ((uint8_t)p[i] & 0x3F);
+    }
+    if (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) return REPLACEMENT_CHAR;
+    p += extra;
+    return cp;
+}
+
+size_t Utf8Prefix(const std::string &text, size_t max_chars) {
+    const char *p = text.data();
+    const char *end = p + text.size();
+    for (size_t n = 0; n < max_chars && p < end; ++n) NextCodepoint(p, end);
+    return p - text.data();
+}
+
+TextMeasurer::TextMeasurer(const rgb_matrix::Font &font)
+    : font_(font), bmp_(0x10000, UNKNOWN) {}
+
+int TextMeasurer::FontWidth(uint32_t codepoint) const {
+    int w = font_.CharacterWidth(codepoint);
+    if (w < 0) w = font_.CharacterWidth(REPLACEMENT_CHAR); // what DrawGlyph would draw
+    return (w < 0) ? 0 : w;
+}
+
+int TextMeasurer::CharWidth(uint32_t codepoint) {
+    if (codepoint < 0x10000) {
+        int8_t &w = bmp_[codepoint];
+        if (w == UNKNOWN) w = (int8_t)std::min(FontWidth(codepoint), 127);
+        return w;
+    }
+    auto it = astral_.find(codepoint);
+    if (it != astral_.end()) return it->second;
+    const int w = FontWidth(codepoint);
+    astral_.emplace(codepoint, w);
+    return w;
+}
+
+int TextMeasurer::Width(const std::string &text) {
+    // FNV-1a, only used to skip string compares against the memo slots
+    uint64_t hash = 14695981039346656037ULL;
+    for (char c : text) {
+        hash ^= (uint8_t)c;
+        hash *= 1099511628211ULL;
+    }
+    for (const Memo &m : memo_) {
+        if (m.used && m.hash == hash && m.text == text) return m.width;
+    }
+
+    int width = 0;
+    const char *p = text.data();
+    const char *end = p + text.size();
+    while (p < end) width += CharWidth(NextCodepoint(p, end));
+
+    Memo &slot = memo_[memo_next_];
+    memo_next_ = (memo_next_ + 1) % MEMO_SLOTS;
+    slot.text = text;
+    slot.hash = hash;
+    slot.width = width;
+    slot.used = true;
+    return width;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include <rpi-rgb-led-matrix/include/graphics.h>
+
+// Decode the next UTF-8 codepoint from [p, end) and advance p past it.
+// Malformed or truncated sequences decode as U+FFFD and consume one byte, so a bad
+// payload can never walk past the end of the string.
+uint32_t NextCodepoint(const char *&p, const char *end);
+
+// Byte length of the first max_chars codepoints of text, for truncating without
+// cutting a multi-byte character in half.
+size_t Utf8Prefix(const std::string &text, size_t max_chars);
+
+// Measures text the way DrawText lays it out: one glyph per codepoint, with a missing
+// glyph falling back to the font's U+FFFD glyph (or zero width if that is missing too).
+//
+// Glyph widths are cached per codepoint in a flat table for the BMP and a hash map for
+// anything above it, so the font is asked about each character only once. Whole-string
+// widths are memoized in a few slots so re-measuring the same track or summary is free.
+class TextMeasurer {
+public:
+    explicit TextMeasurer(const rgb_matrix::Font &font);
+
+    int CharWidth(uint32_t codepoint);
+    int Width(const std::string &text);
+
+private:
+    int FontWidth(uint32_t codepoint) const;
+
+    static constexpr int8_t UNKNOWN = -1;
+    static constexpr int MEMO_SLOTS = 8;
+
+    struct Memo {
+        std::string text;
+        uint64_t hash = 0;
+        int width = 0;
+        bool used = false;
+    };
+
+    const rgb_matrix::Font &font_;
+    std::vector<int8_t> bmp_;                      // 0x10000 entries, UNKNOWN until asked
+    std::unordered_map<uint32_t, int> astral_;     // codepoints above the BMP
+    Memo memo_[MEMO_SLOTS];
+    int memo_next_ = 0;                            // round-robin replacement
+};
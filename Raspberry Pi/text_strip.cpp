@@ -0,0 +1,90 @@
+#include "text_strip.h"
+#include <algorithm>
+#include <cstring>
+#include "software_canvas.h"
+#include "frame_hash.h"
+
+void TextStrip::Rasterize(GlyphAtlas &atlas, const std::string &text, int cycle) {
+    width_ = (cycle > 0) ? cycle : 0;
+    height_ = atlas.height();
+    baseline_ = atlas.baseline();
+    mask_.assign((size_t)width_ * height_, 0);
+    spans_.clear();
+    rowStart_.assign(height_ + 1, 0);
+    hash_ = HashMix(HashMix(0, (uint64_t)width_ << 32 | (uint32_t)height_), (uint32_t)baseline_);
+    if (width_ == 0) return;
+    if (!text.empty()) atlas.DrawMask(mask_.data(), width_, height_, 0, baseline_, text);
+    hash_ = HashMix(hash_, HashFrame(mask_.data(), mask_.size()));
+
+    for (int y = 0; y < height_; ++y) {
+        const uint8_t *row = &mask_[(size_t)y * width_];
+        for (int x = 0; x < width_;) {
+            if (!row[x]) {
+                ++x;
+                continue;
+            }
+            const int start = x;
+            while (x < width_ && row[x]) ++x;
+            spans_.push_back(Span{ start, x - start });
+        }
+        rowStart_[y + 1] = (uint32_t)spans_.size();
+    }
+}
+
+void TextStrip::Draw(rgb_matrix::Canvas *canvas, const Rect &clip, int x, int y,
+                     const rgb_matrix::Color &color, int copies, int frac,
+                     const ColorLut *lut) const {
+    if (width_ == 0 || copies <= 0) return;
+    if (lut && lut->identity()) lut = nullptr;
+    Rect box = Box(x, y, copies);
+    if (frac > 0) box.x1 += 1; // the last column spills into the next pixel
+    Rect r = Intersect(clip, MakeRect(0, 0, canvas->width(), canvas->height()));
+    r = Intersect(r, box);
+    if (r.Empty()) return;
+
+    const int top = y - baseline_;
+    if (frac > 0) {
+        // Pixel xx overlaps strip column k = xx - x by (256 - frac)/256 and column k - 1 by frac/256
+        const int total = width_ * copies;
+        const int k0 = r.x0 - x;
+        for (int yy = r.y0; yy < r.y1; ++yy) {
+            const uint8_t *row = &mask_[(size_t)(yy - top) * width_];
+            int k = k0, sx = k0 % width_;
+            uint8_t prev = k0 > 0 ? row[(k0 - 1) % width_] : 0;
+            for (int xx = r.x0; xx < r.x1; ++xx, ++k) {
+                const uint8_t cur = k < total ? row[sx] : 0;
+                const int cover = (cur ? 256 - frac : 0) + (prev ? frac : 0);
+                if (cover) {
+                    const uint8_t cr = color.r * cover >> 8, cg = color.g * cover >> 8, cb = color.b * cover >> 8;
+                    if (lut) canvas->SetPixel(xx, yy, lut->r(cr), lut->g(cg), lut->b(cb));
+                    else canvas->SetPixel(xx, yy, cr, cg, cb);
+                }
+                prev = cur;
+                if (++sx == width_) sx = 0;
+            }
+        }
+        return;
+    }
+
+    // Whole pixels all share one color, so it is mapped once. Each row is written as runs,
+    // once per copy of the strip that reaches into the clip.
+    const rgb_matrix::Color c = lut ? lut->Map(color) : color;
+    SoftwareCanvas *sw = dynamic_cast<SoftwareCanvas *>(canvas);
+    const int firstCopy = (r.x0 - x) / width_; // r.x0 >= x so this is never negative
+    const int lastCopy = std::min(copies - 1, (r.x1 - 1 - x) / width_);
+    for (int yy = r.y0; yy < r.y1; ++yy) {
+        const Span *begin = spans_.data() + rowStart_[yy - top];
+        const Span *end = spans_.data() + rowStart_[yy - top + 1];
+        for (int copy = firstCopy; copy <= lastCopy; ++copy) {
+            // Spans are in x order, so skip straight to the first one reaching into the clip
+            const int base = x + copy * width_;
+            const Span *s = std::lower_bound(begin, end, r.x0 - base,
+                                             [](const Span &sp, int lo) { return sp.x + sp.len <= lo; });
+            for (; s != end && base + s->x < r.x1; ++s) {
+                const int x0 = std::max(base + s->x, r.x0), x1 = std::min(base + s->x + s->len, r.x1);
+                if (sw) sw->FillSpan(x0, yy, x1 - x0, c.r, c.g, c.b);
+                else for (int xx = x0; xx < x1; ++xx) canvas->SetPixel(xx, yy, c.r, c.g, c.b);
+            }
+        }
+    }
+}
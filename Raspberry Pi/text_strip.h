@@ -0,0 +1,54 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <rpi-rgb-led-matrix/include/graphics.h>
+#include "damage.h"
+#include "color_lut.h"
+#include "glyph_atlas.h"
+
+// A line of text rasterized once into an off-screen coverage strip.
+// DrawText walks the BDF glyphs and sets pixels one at a time, which is fine once but
+// wasteful 20+ times a second for a marquee. The strip is built from the font's glyph atlas
+// when the text changes, and kept both as a mask and as horizontal runs per row. Each frame
+// writes whole runs into the canvas at whole-pixel positions, or blends from the mask at
+// fractional ones.
+class TextStrip {
+public:
+    // Rasterize text from the atlas. cycle is the strip width in pixels, usually the text
+    // width, or text width + gap for a marquee so the gap is part of the strip.
+    void Rasterize(GlyphAtlas &atlas, const std::string &text, int cycle);
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    bool empty() const { return width_ == 0; }
+
+    // Hash of the rasterized strip, so two texts that come out the same pixels compare equal
+    uint64_t hash() const { return hash_; }
+
+    // Screen box covered by `copies` back-to-back copies of the strip at x, baseline y
+    Rect Box(int x, int y, int copies = 1) const {
+        return MakeRect(x, y - baseline_, width_ * copies, height_);
+    }
+
+    // Copy the strip into canvas with its left edge at x + frac/256 and baseline at y, repeated
+    // `copies` times back to back (2 for a seamless marquee wrap). Only pixels inside
+    // clip are touched, and the clip is resolved once up front rather than per pixel.
+    // A fractional position is anti-aliased horizontally: each pixel is blended from the two
+    // strip columns it overlaps, so text moving less than a pixel per frame still moves smoothly.
+    // Colors go through lut when one is given, after blending.
+    void Draw(rgb_matrix::Canvas *canvas, const Rect &clip, int x, int y,
+              const rgb_matrix::Color &color, int copies = 1, int frac = 0,
+              const ColorLut *lut = nullptr) const;
+
+private:
+    struct Span { int x, len; };
+
+    std::vector<uint8_t> mask_; // width_ * height_, non-zero where a glyph pixel is set
+    std::vector<Span> spans_;   // runs of set mask pixels, row by row
+    std::vector<uint32_t> rowStart_; // height_ + 1 offsets into spans_
+    int width_ = 0;
+    int height_ = 0;
+    int baseline_ = 0;
+    uint64_t hash_ = 0;
+};